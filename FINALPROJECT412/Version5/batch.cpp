@@ -0,0 +1,293 @@
+//
+//  batch.cpp
+//  Final Project CSC412
+//
+//	Entry point of traveler_batch, which runs many independent headless
+//	simulations, for parameter sweeps and Monte Carlo estimates, and writes
+//	one CSV row per run.  rows, cols, numTravelers and numMovesForGrowth can
+//	each be a comma-separated list of values: each combination is run --runs=N
+//	times, with the seeds seed, seed+1, ... (seed being that of --seed=N, or a
+//	random one), so that any run can be replayed alone from its row.
+//
+//	The simulation keeps its state in global variables, so each run gets a
+//	process of its own.  The batch forks a child per run, up to --jobs=N at a
+//	time (by default, one per core), which builds its maze, runs it and writes
+//	its row to a pipe it shares with the parent.  A row is shorter than
+//	PIPE_BUF, so the child writes it at once and never blocks.  The parent
+//	starts the next run as soon as one ends, and writes the rows in the order
+//	the runs end.  With --scheduler=pool --workers=1, each run uses one core.
+//
+//	Usage: traveler_batch rows cols numTravelers [numMovesForGrowth] [--runs=N]
+//						  [--jobs=N] [--csv=file] [simulation options]
+
+#include <vector>
+#include <string>
+#include <random>
+//
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <climits>
+#include <unistd.h>
+#include <sys/wait.h>
+//
+#include "simulation.h"
+
+using namespace std;
+
+//-----------------------------------------------------------------------------
+//	Custom Data Types
+//-----------------------------------------------------------------------------
+struct BatchRun
+{
+	unsigned int rows;
+	unsigned int cols;
+	unsigned int travelers;
+	unsigned int movesForGrowth;
+	unsigned long long seed;
+};
+
+//	A run in progress
+struct BatchChild
+{
+	pid_t pid;
+	unsigned int run;
+	//	Reading end of the pipe to the child
+	int fd;
+};
+
+//-----------------------------------------------------------------------------
+//	Global variables
+//-----------------------------------------------------------------------------
+
+const char* CSV_HEADER = "run,seed,rows,cols,travelers,moves_for_growth,engine,scheduler,nav,budget_s,"
+						 "elapsed_s,travelers_exited,all_exited_s,mean_exit_s,p50_exit_s,p99_exit_s,"
+						 "moves,moves_per_sec,failed_moves,lock_wait_s,cpu_s,peak_rss_kb,status\n";
+//	Longest row, within PIPE_BUF
+const unsigned int MAX_ROW_LENGTH = 1024;
+
+//-----------------------------------------------------------------------------
+//	Functions
+//-----------------------------------------------------------------------------
+
+//	Parses a comma-separated list of unsigned integers.  Returns false if it
+//	is not one.
+bool parseList(const char* arg, vector<unsigned int>& values)
+{
+	values.clear();
+	const char* p = arg;
+	while (true)
+	{
+		char* end;
+		unsigned long value = strtoul(p, &end, 10);
+		if (end == p || value > UINT_MAX || (*end != ',' && *end != '\0'))
+			return false;
+		values.push_back(value);
+		if (*end == '\0')
+			return true;
+		p = end + 1;
+	}
+}
+
+//	The first columns of a run's row: what was run
+void formatRunColumns(unsigned int index, const BatchRun& run, char* row, size_t size)
+{
+	const char* schedulerName[NUM_SCHEDULERS] = {"threads", "pool", "tiles"};
+	snprintf(row, size, "%u,%llu,%u,%u,%u,%u,%s,%s,%s,%.3f,", index, run.seed, run.rows, run.cols,
+			 run.travelers, run.movesForGrowth, occupancyEngine == ATOMIC_ENGINE ? "atomic" : "mutex",
+			 schedulerName[schedulerMode], navigationMode == FLOW_NAVIGATION ? "flow" : "random",
+			 headlessBudget);
+}
+
+//	A time of the statistics, empty when there is none
+void formatTime(double time, char* field, size_t size)
+{
+	if (time < 0)
+		field[0] = '\0';
+	else
+		snprintf(field, size, "%.6f", time);
+}
+
+//	Runs a simulation in the child process and writes its row to fd
+void runChild(unsigned int index, const BatchRun& run, int fd)
+{
+	numRows = run.rows;
+	numCols = run.cols;
+	numTravelers = run.travelers;
+	numMovesForGrowth = run.movesForGrowth;
+	randomSeed = run.seed;
+	seedGiven = true;
+	headlessMode = true;
+#ifdef LOCK_STATS
+	lockStatsPath += "_" + to_string(index);
+#endif
+
+	RunStats stats;
+	runHeadless(stats);
+
+	char row[MAX_ROW_LENGTH], allExited[32], meanExit[32], p50Exit[32], p99Exit[32];
+	formatRunColumns(index, run, row, sizeof(row));
+	formatTime(stats.allExitedTime, allExited, sizeof(allExited));
+	formatTime(stats.meanExitTime, meanExit, sizeof(meanExit));
+	formatTime(stats.p50ExitTime, p50Exit, sizeof(p50Exit));
+	formatTime(stats.p99ExitTime, p99Exit, sizeof(p99Exit));
+	size_t length = strlen(row);
+	snprintf(row + length, sizeof(row) - length, "%.6f,%u,%s,%s,%s,%s,%llu,%.1f,%llu,%.6f,%.3f,%ld,ok\n",
+			 stats.elapsed, stats.travelersExited, allExited, meanExit, p50Exit, p99Exit, stats.moves,
+			 stats.elapsed > 0 ? stats.moves / stats.elapsed : 0.0, stats.failedMoves, stats.lockWait,
+			 stats.cpu, stats.peakRssKb);
+	if (write(fd, row, strlen(row)) < 0)
+		perror("traveler_batch");
+}
+
+//	Forks the child of a run.  Exits if it can't.
+BatchChild startRun(unsigned int index, const BatchRun& run, FILE* csv)
+{
+	int fds[2];
+	if (pipe(fds) != 0)
+	{
+		perror("traveler_batch");
+		exit(1);
+	}
+	//	The child must not write the parent's buffered output again
+	fflush(csv);
+	fflush(stderr);
+	pid_t pid = fork();
+	if (pid < 0)
+	{
+		perror("traveler_batch");
+		exit(1);
+	}
+	if (pid == 0)
+	{
+		close(fds[0]);
+		runChild(index, run, fds[1]);
+		close(fds[1]);
+		_exit(0);
+	}
+	close(fds[1]);
+	BatchChild child = {pid, index, fds[0]};
+	return child;
+}
+
+//	Reads the row of a child that has terminated.  A child that failed
+//	gets a row with its parameters only.
+void finishRun(const BatchChild& child, const BatchRun& run, int status, FILE* csv)
+{
+	char row[MAX_ROW_LENGTH];
+	size_t length = 0;
+	ssize_t count;
+	while (length < sizeof(row) - 1 && (count = read(child.fd, row + length, sizeof(row) - 1 - length)) > 0)
+		length += count;
+	row[length] = '\0';
+	close(child.fd);
+
+	if (WIFEXITED(status) && WEXITSTATUS(status) == 0 && length > 0 && row[length-1] == '\n')
+		fputs(row, csv);
+	else
+	{
+		formatRunColumns(child.run, run, row, sizeof(row));
+		fprintf(csv, "%s,,,,,,,,,,,,failed\n", row);
+		if (WIFSIGNALED(status))
+			fprintf(stderr, "Run %u was killed by signal %d\n", child.run, WTERMSIG(status));
+		else
+			fprintf(stderr, "Run %u failed\n", child.run);
+	}
+	fflush(csv);
+}
+
+
+int main(int argc, char** argv)
+{
+	unsigned int numRuns = 1;
+	long numJobs = sysconf(_SC_NPROCESSORS_ONLN);
+	const char* csvPath = NULL;
+	vector<const char*> posArgs;
+	bool argsOK = true;
+	for (int k = 1; k < argc; k++)
+	{
+		if (strncmp(argv[k], "--runs=", 7) == 0)
+			numRuns = atoi(argv[k] + 7);
+		else if (strncmp(argv[k], "--jobs=", 7) == 0)
+			numJobs = atoi(argv[k] + 7);
+		else if (strncmp(argv[k], "--csv=", 6) == 0)
+			csvPath = argv[k] + 6;
+		else if (strncmp(argv[k], "--", 2) != 0)
+			posArgs.push_back(argv[k]);
+		else if (!parseOption(argv[k]))
+		{
+			fprintf(stderr, "Unknown option %s\n", argv[k]);
+			argsOK = false;
+		}
+	}
+	//	The runs build their own mazes and write no file
+	if (!mazePath.empty() || !saveMazePath.empty() || !journalPath.empty() || !exportName.empty())
+	{
+		fprintf(stderr, "--maze, --restore, --save-maze, --journal and --export can't be used in a batch\n");
+		argsOK = false;
+	}
+	vector<unsigned int> values[4];
+	values[3].push_back(INT_MAX);
+	argsOK = argsOK && (posArgs.size() == 3 || posArgs.size() == 4) && numRuns > 0 && numJobs > 0;
+	for (unsigned int k = 0; k < posArgs.size() && argsOK; k++)
+		argsOK = parseList(posArgs[k], values[k]);
+	if (!argsOK)
+	{
+		fprintf(stderr, "Usage: %s rows cols numTravelers [numMovesForGrowth] [--runs=N] [--jobs=N]"
+				" [--csv=file] [--engine=mutex|atomic] [--scheduler=threads|pool|tiles] [--workers=N]"
+				" [--nav=random|flow] [--seed=N] [--budget=seconds]\n", argv[0]);
+		fprintf(stderr, "   (rows, cols, numTravelers and numMovesForGrowth can be lists: 100,200,400)\n");
+		exit(1);
+	}
+
+	if (!seedGiven)
+		randomSeed = (static_cast<unsigned long long>(random_device()()) << 32) | random_device()();
+	vector<BatchRun> runs;
+	for (unsigned int rows : values[0])
+		for (unsigned int cols : values[1])
+			for (unsigned int travelers : values[2])
+				for (unsigned int movesForGrowth : values[3])
+					for (unsigned int k = 0; k < numRuns; k++)
+					{
+						BatchRun run = {rows, cols, travelers, movesForGrowth, randomSeed + runs.size()};
+						runs.push_back(run);
+					}
+
+	FILE* csv = stdout;
+	if (csvPath != NULL && (csv = fopen(csvPath, "w")) == NULL)
+	{
+		perror(csvPath);
+		exit(1);
+	}
+	fputs(CSV_HEADER, csv);
+
+	//	Keeps numJobs runs going until all have been started
+	vector<BatchChild> children;
+	unsigned int nextRun = 0;
+	while (nextRun < runs.size() || !children.empty())
+	{
+		while (nextRun < runs.size() && children.size() < (size_t) numJobs)
+		{
+			children.push_back(startRun(nextRun, runs[nextRun], csv));
+			nextRun++;
+		}
+		int status;
+		pid_t pid = wait(&status);
+		if (pid < 0)
+		{
+			perror("traveler_batch");
+			exit(1);
+		}
+		for (unsigned int k = 0; k < children.size(); k++)
+			if (children[k].pid == pid)
+			{
+				finishRun(children[k], runs[children[k].run], status, csv);
+				children.erase(children.begin() + k);
+				break;
+			}
+	}
+
+	if (csv != stdout)
+		fclose(csv);
+	return 0;
+}
@@ -0,0 +1,141 @@
+//
+//  benchmark.cpp
+//  Final Project CSC412
+//
+//	Headless benchmark mode: runs the traveler threads without rendering and
+//	with no sleep between moves, until all travelers have exited or the time
+//	budget runs out, then prints machine-readable statistics as JSON on stdout.
+
+#include <vector>
+#include <algorithm>
+//
+#include <cstdio>
+#include <unistd.h>
+#include <sys/resource.h>
+//
+#include "simulation.h"
+
+using namespace std;
+
+//	How often the main thread checks on the travelers (in microseconds)
+const int HEADLESS_POLL_TIME = 1000;
+
+
+//	Runs the simulation with no rendering and no sleep between moves, until
+//	all travelers have exited or the time budget runs out
+void runHeadless(RunStats& stats)
+{
+	travelerSleepTime = 0;
+	initializeApplication();
+
+	//	Wait until all traveler threads have terminated, asking them to stop
+	//	once the time budget is spent
+	double runTime = 0.0;
+	bool allDone = false;
+	while (!allDone)
+	{
+		usleep(HEADLESS_POLL_TIME);
+		lockMutex(&globalLock, GLOBAL_LOCK);
+			allDone = (numLiveThreads == 0);
+		unlockMutex(&globalLock, GLOBAL_LOCK);
+		if (!stopRequested)
+		{
+			runTime = elapsedSeconds();
+			if (runTime >= headlessBudget)
+			{
+				stopRequested = true;
+				unparkAllTravelers();
+			}
+		}
+	}
+
+	//	All threads are gone, so the traveler list can be read without locking.
+	//	A run restored from a checkpoint is measured from the restore on: the
+	//	exit times (run times) are moved to that base, and the moves and exits
+	//	from before the checkpoint are left out.
+	unsigned long long totalMoves = 0;
+	vector<double> exitTimes;
+	for (unsigned int k=0; k<travelers.count; k++)
+	{
+		totalMoves += travelers.totalMoves[k];
+		if (travelers.exitTime[k] >= 0 && (!restoreState || travelers.exitTime[k] > restoredRunTime))
+			exitTimes.push_back(travelers.exitTime[k] - restoredRunTime);
+	}
+	sort(exitTimes.begin(), exitTimes.end());
+	double meanExit = 0.0;
+	for (unsigned int k=0; k<exitTimes.size(); k++)
+		meanExit += exitTimes[k];
+
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+
+	stats.elapsed = runTime;
+	stats.travelersExited = exitTimes.size();
+	stats.allExitedTime = -1.0;
+	if (travelers.count > 0 && restoredExited + exitTimes.size() == travelers.count)
+		stats.allExitedTime = exitTimes.empty() ? 0.0 : exitTimes.back();
+	stats.meanExitTime = stats.p50ExitTime = stats.p99ExitTime = -1.0;
+	if (!exitTimes.empty())
+	{
+		//	nearest-rank percentiles
+		unsigned int n = exitTimes.size();
+		stats.meanExitTime = meanExit / n;
+		stats.p50ExitTime = exitTimes[(n - 1) / 2];
+		stats.p99ExitTime = exitTimes[(99 * n + 99) / 100 - 1];
+	}
+	stats.moves = totalMoves - restoredMoves;
+	stats.failedMoves = totalFailedMoves;
+	stats.lockWait = 1E-9 * totalLockWaitNs;
+	stats.cpu = usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+				1E-6 * (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec);
+	stats.peakRssKb = usage.ru_maxrss;
+	stats.restoredRunTime = restoredRunTime;
+	stats.restoredMoves = restoredMoves;
+	stats.restoredExited = restoredExited;
+
+	freeApplication();
+}
+
+//	Runs the simulation headless, then prints machine-readable statistics
+//	as JSON on stdout
+int runHeadlessBenchmark(void)
+{
+	RunStats stats;
+	runHeadless(stats);
+
+	printf("{\n");
+	printf("  \"engine\": \"%s\",\n", occupancyEngine == ATOMIC_ENGINE ? "atomic" : "mutex");
+	const char* schedulerName[NUM_SCHEDULERS] = {"threads", "pool", "tiles"};
+	printf("  \"scheduler\": \"%s\",\n", schedulerName[schedulerMode]);
+	printf("  \"nav\": \"%s\",\n", navigationMode == FLOW_NAVIGATION ? "flow" : "random");
+	printf("  \"seed\": %llu,\n", randomSeed);
+	printf("  \"rows\": %u,\n", numRows);
+	printf("  \"cols\": %u,\n", numCols);
+	printf("  \"travelers\": %u,\n", numTravelers);
+	printf("  \"moves_for_growth\": %u,\n", numMovesForGrowth);
+	printf("  \"budget_s\": %.3f,\n", headlessBudget);
+	printf("  \"elapsed_s\": %.6f,\n", stats.elapsed);
+	printf("  \"travelers_exited\": %u,\n", stats.travelersExited);
+	if (stats.allExitedTime < 0)
+		printf("  \"all_exited_s\": null,\n");
+	else
+		printf("  \"all_exited_s\": %.6f,\n", stats.allExitedTime);
+	printf("  \"moves\": %llu,\n", stats.moves);
+	printf("  \"moves_per_sec\": %.1f,\n", stats.elapsed > 0 ? stats.moves / stats.elapsed : 0.0);
+	printf("  \"failed_moves\": %llu,\n", stats.failedMoves);
+	if (stats.travelersExited == 0)
+		printf("  \"time_to_exit_s\": null,\n");
+	else
+		printf("  \"time_to_exit_s\": {\"mean\": %.6f, \"p50\": %.6f, \"p99\": %.6f},\n",
+			   stats.meanExitTime, stats.p50ExitTime, stats.p99ExitTime);
+	printf("  \"lock_wait_s\": %.6f,\n", stats.lockWait);
+	printf("  \"cpu_s\": %.3f,\n", stats.cpu);
+	printf("  \"peak_rss_kb\": %ld,\n", stats.peakRssKb);
+	if (!restoreState)
+		printf("  \"restored\": null\n");
+	else
+		printf("  \"restored\": {\"run_time_s\": %.6f, \"moves\": %llu, \"travelers_exited\": %u}\n",
+			   stats.restoredRunTime, stats.restoredMoves, stats.restoredExited);
+	printf("}\n");
+	return 0;
+}
@@ -0,0 +1,167 @@
+//
+//  checkpoint.cpp
+//  Final Project CSC412
+//
+//	Checkpoints of a running simulation.  SIGUSR1 (or the 'c' key) writes the
+//	whole state of the run to the checkpoint file (--checkpoint=file), and
+//	--restore=file starts a run from it.  A checkpoint is a maze file with the
+//	travelers' state added (see maze.cpp), so restoring maps it like --maze
+//	does, without replaying anything.
+//
+//	The travelers are paused while the file is written.  Each thread that runs
+//	travelers (a traveler thread, or one worker for the pool and the tiles,
+//	whose other workers are then blocked at their tick barrier) is a runner.
+//	Runners check pauseRequested between moves, which costs a relaxed load, and
+//	wait in pausePoint while it is set (parked travelers are woken first).  The
+//	checkpoint is written once all runners wait, so no square, traveler or
+//	partition is changing.
+//
+//	The signal is blocked in all threads but the checkpoint thread, which
+//	waits for it with sigwait, so the checkpoint is not written from a signal
+//	handler.
+
+#include <string>
+//
+#include <cstdio>
+#include <csignal>
+#include <ctime>
+#include <unistd.h>
+//
+#include "simulation.h"
+
+using namespace std;
+
+//-----------------------------------------------------------------------------
+//	Global variables
+//-----------------------------------------------------------------------------
+
+string checkpointPath = "traveler.ckpt";
+bool restoreState = false;
+double restoredRunTime = 0.0;
+unsigned long long restoredMoves = 0;
+unsigned int restoredExited = 0;
+atomic<bool> pauseRequested(false);
+
+//	Runners, and those of them waiting in pausePoint
+pthread_mutex_t pauseLock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t pauseCond = PTHREAD_COND_INITIALIZER;
+unsigned int numRunners = 0;
+unsigned int numPaused = 0;
+
+pthread_t checkpointThread;
+bool checkpointThreadStarted = false;
+atomic<bool> checkpointThreadQuit(false);
+
+//-----------------------------------------------------------------------------
+//	Private functions' prototypes
+//-----------------------------------------------------------------------------
+void* checkpointThreadFunc(void* arg);
+
+
+void addRunners(unsigned int count)
+{
+	pthread_mutex_lock(&pauseLock);
+		numRunners += count;
+	pthread_mutex_unlock(&pauseLock);
+}
+
+//	A runner that terminates may be the last one a pause waits for
+void removeRunner(void)
+{
+	pthread_mutex_lock(&pauseLock);
+		numRunners--;
+		pthread_cond_broadcast(&pauseCond);
+	pthread_mutex_unlock(&pauseLock);
+}
+
+void pausePoint(void)
+{
+	pthread_mutex_lock(&pauseLock);
+		numPaused++;
+		pthread_cond_broadcast(&pauseCond);
+		while (pauseRequested.load(memory_order_relaxed))
+			pthread_cond_wait(&pauseCond, &pauseLock);
+		numPaused--;
+	pthread_mutex_unlock(&pauseLock);
+}
+
+//	Returns once all runners wait in pausePoint.  The mutex orders their last
+//	moves before the caller's reads.
+void pauseSimulation(void)
+{
+	pthread_mutex_lock(&pauseLock);
+		pauseRequested.store(true, memory_order_relaxed);
+		unparkAllTravelers();
+		while (numPaused < numRunners)
+			pthread_cond_wait(&pauseCond, &pauseLock);
+	pthread_mutex_unlock(&pauseLock);
+}
+
+void resumeSimulation(void)
+{
+	pthread_mutex_lock(&pauseLock);
+		pauseRequested.store(false, memory_order_relaxed);
+		pthread_cond_broadcast(&pauseCond);
+	pthread_mutex_unlock(&pauseLock);
+}
+
+//	The run time, counting that of the run the simulation was restored from
+double runTimeSeconds(void)
+{
+	return restoredRunTime + elapsedSeconds();
+}
+
+//	Pauses the travelers, writes the checkpoint file and resumes them
+bool writeCheckpoint(void)
+{
+	struct timespec start, end;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	pauseSimulation();
+		bool written = saveMazeFile(checkpointPath.c_str(), true);
+	resumeSimulation();
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	if (written)
+		fprintf(stderr, "Checkpoint written to %s (travelers paused for %.1f ms)\n", checkpointPath.c_str(),
+				1E3 * (end.tv_sec - start.tv_sec) + 1E-6 * (end.tv_nsec - start.tv_nsec));
+	return written;
+}
+
+//	Asks the checkpoint thread for a checkpoint, as SIGUSR1 from outside does
+void requestCheckpoint(void)
+{
+	kill(getpid(), SIGUSR1);
+}
+
+//	Blocks SIGUSR1 in the calling thread, and so in the threads it creates
+//	from now on, then starts the checkpoint thread.  To be called before the
+//	travelers are started.
+void startCheckpointThread(void)
+{
+	sigset_t signals;
+	sigemptyset(&signals);
+	sigaddset(&signals, SIGUSR1);
+	pthread_sigmask(SIG_BLOCK, &signals, NULL);
+	checkpointThreadQuit = false;
+	checkpointThreadStarted = pthread_create(&checkpointThread, NULL, checkpointThreadFunc, NULL) == 0;
+}
+
+void stopCheckpointThread(void)
+{
+	if (!checkpointThreadStarted)
+		return;
+	checkpointThreadQuit = true;
+	pthread_kill(checkpointThread, SIGUSR1);
+	pthread_join(checkpointThread, NULL);
+	checkpointThreadStarted = false;
+}
+
+void* checkpointThreadFunc(void* arg)
+{
+	sigset_t signals;
+	sigemptyset(&signals);
+	sigaddset(&signals, SIGUSR1);
+	int signal;
+	while (sigwait(&signals, &signal) == 0 && !checkpointThreadQuit)
+		writeCheckpoint();
+	return NULL;
+}
@@ -10,6 +10,9 @@
 
 #include <vector>
 #include <string>
+#include <atomic>
+#include <pthread.h>
+#include <stdint.h>
 
 /**	Travel Direction data type.
  *	Note that if you define a variable
@@ -42,6 +45,72 @@ enum SquareType
 	NUM_SQUARE_TYPES
 };
 
+/**	Occupancy engines used to synchronize access to the grid squares
+ */
+enum OccupancyEngine
+{
+	//	one pthread_mutex_t per square, next to the SquareType grid
+	MUTEX_ENGINE = 0,
+	//	one packed atomic byte per square, claimed/released with compare-and-swap
+	ATOMIC_ENGINE,
+	//
+	NUM_ENGINES
+};
+
+/**	How the travelers are mapped onto threads
+ */
+enum SchedulerMode
+{
+	//	one pthread per traveler
+	THREAD_SCHEDULER = 0,
+	//	travelers are tasks run by a fixed pool of worker threads
+	POOL_SCHEDULER,
+	//	the grid is split into tiles, each with a worker running the
+	//	travelers whose head is in it
+	TILE_SCHEDULER,
+	//
+	NUM_SCHEDULERS
+};
+
+/**	How the travelers choose where to go
+ */
+enum NavigationMode
+{
+	//	a random direction at each move
+	RANDOM_NAVIGATION = 0,
+	//	down the exit distance field, random when no closer square is free
+	FLOW_NAVIGATION,
+	//
+	NUM_NAVIGATION_MODES
+};
+
+/**	The locks of the simulation, as counted by the lock statistics
+ *	(built with LOCK_STATS)
+ */
+enum LockClass
+{
+	//	numTravelersDone/numLiveThreads
+	GLOBAL_LOCK = 0,
+	//	one per square, with --engine=mutex
+	GRID_LOCK,
+	//	one flag per partition, only ever tried
+	PARTITION_FLAG,
+	//	the segment arena's free lists
+	ARENA_LOCK,
+	//	the repairs of the exit distance field
+	REPAIR_LOCK,
+	//	the journal file
+	JOURNAL_LOCK,
+	//	the task deques of the worker pool
+	TASK_LOCK,
+	//	the inboxes of the tiles
+	INBOX_LOCK,
+	//	the buckets of the parking lot
+	PARK_LOCK,
+	//
+	NUM_LOCK_CLASSES
+};
+
 /**	Data type to store the position of *things* on the grid
  */
 struct GridPosition
@@ -72,8 +141,80 @@ struct TravelerSegment
 
 
 /**
- *	Data type for storing all information about a traveler
- *	Feel free to add anything you need.
+ *	State of a xoshiro256** pseudo-random generator.  Each traveler has its
+ *	own, and so does the maze generation, all derived from the run's seed.
+ */
+struct RandomState
+{
+	uint64_t s[4];
+};
+
+/**
+ *	Data type for storing all the travelers, as a structure of arrays indexed by
+ *	traveler, so that a loop over the travelers reads contiguous memory.
+ *	The segments of traveler k are stored as a circular buffer carved from the
+ *	simulation's segment arena: segment i (0 being the head) is at offset
+ *		bodyOffset[k] + ((bodyHead[k] + i) & (capacity[k] - 1))
+ *	in the arena.  A move writes the new head in front of the old one, so neither
+ *	a move nor a growth has to shift the other segments.
+ */
+struct TravelerStore
+{
+	/**	The number of travelers
+	 */
+	unsigned int count;
+
+	/**	The position and direction of each traveler's head (a copy of its
+	 *	segment 0, for the move attempts)
+	 */
+	unsigned int* headRow;
+	unsigned int* headCol;
+	Direction* headDir;
+
+	/**	The offset of each traveler's body buffer in the segment arena
+	 */
+	unsigned int* bodyOffset;
+
+	/**	The size of each body buffer (a power of 2)
+	 */
+	unsigned int* capacity;
+
+	/**	The position of the head segment in each body buffer
+	 */
+	unsigned int* bodyHead;
+
+	/**	The number of segments of each traveler (0 once it has exited)
+	 */
+	unsigned int* length;
+
+	/** The number of moves made so far after tail growth
+	 */
+	unsigned int* moves;
+
+	/** The total number of moves made since the traveler was created
+	 */
+	unsigned long* totalMoves;
+
+	/**	The random generator of each traveler
+	 */
+	RandomState* random;
+
+	/** When the traveler reached the exit, in seconds since the traveler
+	 *	threads were launched (negative while still in the maze)
+	 */
+	double* exitTime;
+
+	/**	The color assigned to each traveler, in rgba format (4 floats each)
+	 */
+	float* rgba;
+
+	/** The thread id of each traveler
+	 */
+	pthread_t* pid;
+};
+
+/**
+ *	A copy of one traveler, as made for the renderer by snapshotTraveler
  */
 struct Traveler
 {
@@ -85,19 +226,32 @@ struct Traveler
 	 */
 	float rgba[4];
 	
-	/**	The list of segments that form the 'tail' of the traveler
+	/**	The segments that form the traveler, as a circular buffer: segment i
+	 *	(0 being the head) is body[(head + i) & (capacity - 1)]; use segmentAt
+	 *	to read it.
 	 */
-	std::vector<TravelerSegment> segmentList;
-	
-	/** The thread id for this traveler
+	TravelerSegment* body;
+
+	/**	The size of the body buffer (a power of 2)
 	 */
-	pthread_t pid;
+	unsigned int capacity;
 
-	/** The number of moves made so far after tail growth
+	/**	The position of the head segment in the body buffer
+	 */
+	unsigned int head;
+
+	/**	The number of segments in the traveler
 	 */
-	unsigned int moves;
+	unsigned int length;
 };
 
+/**	Returns segment i of a traveler, 0 being the head
+ */
+inline const TravelerSegment& segmentAt(const Traveler& traveler, unsigned int i)
+{
+	return traveler.body[(traveler.head + i) & (traveler.capacity - 1)];
+}
+
 /**
  *	Data type to represent a sliding partition
  */
@@ -107,12 +261,317 @@ struct SlidingPartition
 	 */
 	bool isVertical;
 
-	/**	The blocks making up the partition, listed
-	 *		top-to-bottom for a vertical list
-	 *		left-to-right for a horizontal list
+	/**	The first block of the partition:
+	 *		the top one for a vertical partition
+	 *		the leftmost one for a horizontal partition
+	 *	The other blocks follow it, so a shift only updates this position.
+	 */
+	GridPosition start;
+
+	/**	The number of blocks making up the partition
+	 */
+	unsigned int length;
+
+};
+
+/**	Kinds of events recorded in a move journal
+ */
+enum JournalEventType
+{
+	//	a traveler's head moved and its tail followed
+	JOURNAL_MOVE = 0,
+	//	a traveler's head moved and its tail stayed (the traveler grew)
+	JOURNAL_GROWTH,
+	//	a traveler left the grid through the exit
+	JOURNAL_EXIT,
+	//	a partition slid by one square
+	JOURNAL_SHIFT,
+	//
+	NUM_JOURNAL_EVENTS
+};
+
+/**
+ *	Header of a move journal file (--journal=file).  The initial state is not
+ *	stored: it is rebuilt from the seed and the dimensions, and checked
+ *	against the grid's checksum.
+ */
+struct JournalHeader
+{
+	/**	"TRVJ"
+	 */
+	char magic[4];
+	/**	The version of the file format
+	 */
+	uint32_t version;
+	/**	The run's seed
+	 */
+	uint64_t seed;
+	/**	Checksum of the grid before the first move
+	 */
+	uint64_t gridChecksum;
+	/**	The dimensions of the grid, the number of travelers and the number
+	 *	of moves before tail growth
+	 */
+	uint32_t numRows;
+	uint32_t numCols;
+	uint32_t numTravelers;
+	uint32_t numMovesForGrowth;
+};
+
+/**
+ *	One record of a move journal.  Squares are numbered row * numCols + col.
+ */
+struct JournalRecord
+{
+	/**	The position of the event among all the events of the run
+	 */
+	uint64_t sequence;
+	/**	The traveler's index, or the partition's for JOURNAL_SHIFT
+	 */
+	uint32_t id;
+	/**	The traveler's move count after the event (0 for JOURNAL_SHIFT)
+	 */
+	uint32_t tick;
+	/**	The square the head (or the end of the partition) left, and the one
+	 *	it moved to.  Both are the exit square for JOURNAL_EXIT.
+	 */
+	uint32_t from;
+	uint32_t to;
+	/**	A JournalEventType
+	 */
+	uint8_t type;
+	/**	The direction of the move
+	 */
+	uint8_t dir;
+	uint8_t reserved[6];
+};
+
+/**
+ *	Header of a maze file (--save-maze=file, --maze=file).  The file is
+ *	mapped into memory as is: the grid section holds the grid's bytes in the
+ *	simulation's layout (border and row padding included), and the partition
+ *	index section the index of the partition on each square, plus one (0 for
+ *	none).  Both start on a page boundary so that they can be used in place.
+ *	A checkpoint (--restore=file) is a maze file saved during a run, with a
+ *	state section for the travelers' counters and random generators.
+ */
+struct MazeHeader
+{
+	/**	"TRVM"
+	 */
+	char magic[4];
+	/**	The version of the file format
+	 */
+	uint32_t version;
+	/**	The size of the file, in bytes
+	 */
+	uint64_t fileSize;
+	/**	The dimensions of the grid, and the distance between its rows
+	 */
+	uint32_t numRows;
+	uint32_t numCols;
+	uint32_t gridStride;
+	/**	The position of the exit
+	 */
+	uint32_t exitRow;
+	uint32_t exitCol;
+	/**	The number of partitions, of travelers, and of segments of all the
+	 *	travelers together
+	 */
+	uint32_t numPartitions;
+	uint32_t numTravelers;
+	uint32_t numSegments;
+	/**	Where the sections start in the file: the grid, the partition index
+	 *	(uint16_t), the partitions (MazePartition), the travelers' lengths
+	 *	(uint32_t) and their segments (MazeSegment), head first, one traveler
+	 *	after the other
+	 */
+	uint64_t gridOffset;
+	uint64_t partitionIndexOffset;
+	uint64_t partitionOffset;
+	uint64_t lengthOffset;
+	uint64_t segmentOffset;
+	/**	Where the state section (MazeTravelerState) starts, 0 if the maze
+	 *	was saved before the travelers started
+	 */
+	uint64_t stateOffset;
+	/**	The run's seed, number of moves before tail growth, number of
+	 *	travelers that solved the maze, and run time in seconds, at the
+	 *	time of the checkpoint
+	 */
+	uint64_t seed;
+	uint32_t numMovesForGrowth;
+	uint32_t numTravelersDone;
+	double runTime;
+};
+
+/**	A partition in a maze file
+ */
+struct MazePartition
+{
+	uint32_t isVertical;
+	uint32_t startRow;
+	uint32_t startCol;
+	uint32_t length;
+};
+
+/**	A traveler's segment in a maze file
+ */
+struct MazeSegment
+{
+	uint32_t row;
+	uint32_t col;
+	uint32_t dir;
+};
+
+/**	The state of a traveler in a checkpoint.  A traveler that has exited
+ *	has no segments.
+ */
+struct MazeTravelerState
+{
+	uint64_t random[4];
+	uint64_t totalMoves;
+	double exitTime;
+	uint32_t moves;
+	uint32_t reserved;
+};
+
+/**
+ *	A maze file mapped into memory
+ */
+struct MazeFile
+{
+	const MazeHeader* header;
+	/**	The grid and partition index sections, writable: the pages are
+	 *	copied when first written to, so the file never changes
+	 */
+	unsigned char* grid;
+	uint16_t* partitionIndex;
+	const MazePartition* partitions;
+	const uint32_t* lengths;
+	const MazeSegment* segments;
+	/**	NULL if the file is not a checkpoint
+	 */
+	const MazeTravelerState* states;
+};
+
+/**
+ *	Header of the shared-memory segment in which a simulation publishes its
+ *	state (--export=name), for traveler_viewer.  The grid section is the
+ *	simulation's grid itself (border and row padding included), so it is
+ *	always current.  The travelers, partitions and counters are copied
+ *	periodically into the two frames in turn: generation is the number of
+ *	frames published so far, the last one being frame generation % 2.
+ */
+struct ExportHeader
+{
+	/**	"TRVX"
+	 */
+	char magic[4];
+	/**	The version of the segment's layout
+	 */
+	uint32_t version;
+	/**	The size of the segment, in bytes
+	 */
+	uint64_t size;
+	/**	The dimensions of the grid, and the distance between its rows
+	 */
+	uint32_t numRows;
+	uint32_t numCols;
+	uint32_t gridStride;
+	/**	The position of the exit
+	 */
+	uint32_t exitRow;
+	uint32_t exitCol;
+	/**	The number of travelers and of partitions, and the number of
+	 *	segments a frame has room for
+	 */
+	uint32_t numTravelers;
+	uint32_t numPartitions;
+	uint32_t maxSegments;
+	/**	The process of the simulation
+	 */
+	int32_t pid;
+	uint32_t reserved;
+	/**	Where the grid and the two frames (ExportFrame) start in the segment
+	 */
+	uint64_t gridOffset;
+	uint64_t frameOffset[2];
+	std::atomic<uint64_t> generation;
+	/**	Set once the simulation has ended (its last frame is published)
+	 */
+	std::atomic<uint32_t> finished;
+};
+
+/**
+ *	A frame of the shared-memory segment.  It is followed by the travelers
+ *	(ExportTraveler), the partitions (MazePartition) and the segments of all
+ *	the travelers, head first, one traveler after the other (MazeSegment).
+ */
+struct ExportFrame
+{
+	/**	Odd while the frame is being written
+	 */
+	std::atomic<uint32_t> seq;
+	/**	The number of segments of all the travelers together
+	 */
+	uint32_t numSegments;
+	/**	The simulation's counters, and its run time in seconds
+	 */
+	uint32_t numTravelersDone;
+	uint32_t numLiveThreads;
+	int32_t travelerSleepTime;
+	uint32_t reserved;
+	double runTime;
+};
+
+/**	A traveler in a frame of the shared-memory segment
+ */
+struct ExportTraveler
+{
+	/**	The number of segments (0 once the traveler has exited)
+	 */
+	uint32_t length;
+	/**	The index of the head segment in the frame's segments
 	 */
-	std::vector<GridPosition> blockList;
+	uint32_t firstSegment;
+	float rgba[4];
+};
 
+
+/**
+ *	Statistics of a headless run (see benchmark.cpp).  Times are in seconds
+ *	since the travelers were launched, and negative when there is no such
+ *	time (no traveler, or not all of them, solved the maze).  After --restore,
+ *	all but the restored fields count from the restore on.
+ */
+struct RunStats
+{
+	double elapsed;
+	unsigned int travelersExited;
+	/**	When the last traveler solved the maze
+	 */
+	double allExitedTime;
+	/**	Mean, median and 99th percentile of the times the travelers exited
+	 */
+	double meanExitTime;
+	double p50ExitTime;
+	double p99ExitTime;
+	unsigned long long moves;
+	/**	Move attempts that didn't move the traveler
+	 */
+	unsigned long long failedMoves;
+	/**	Time spent waiting for a mutex, summed over all threads
+	 */
+	double lockWait;
+	double cpu;
+	long peakRssKb;
+	/**	The run time, moves and travelers that exited before the checkpoint
+	 *	the run was restored from
+	 */
+	double restoredRunTime;
+	unsigned long long restoredMoves;
+	unsigned int restoredExited;
 };
 
 
@@ -128,5 +587,76 @@ std::string dirStr(const Direction& dir);
 */
 std::string typeStr(const SquareType& type);
 
+/**	Seeds a random generator.  Generators seeded with the same seed but
+*	different streams produce unrelated sequences.
+*	@param random the generator
+*	@param seed the run's seed
+*	@param stream the number of the generator's stream
+*/
+void seedRandom(RandomState& random, uint64_t seed, uint64_t stream);
+
+/**	Returns the next 64 random bits of a generator (xoshiro256**)
+*	@param random the generator
+*	@return 64 random bits
+*/
+inline uint64_t nextRandom(RandomState& random)
+{
+	uint64_t* s = random.s;
+	uint64_t result = s[1] * 5;
+	result = ((result << 7) | (result >> 57)) * 9;
+	uint64_t t = s[1] << 17;
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+	s[2] ^= t;
+	s[3] = (s[3] << 45) | (s[3] >> 19);
+	return result;
+}
+
+/**	Returns a random number in [0, n), by multiplying the generator's top
+*	32 bits by n.  Some values come up once more than others out of 2^32/n
+*	draws, a bias of about n/2^32: negligible for the handful of directions
+*	and odds it is used for, but not for a square of the grid (see
+*	uniformBelow).
+*	@param random the generator
+*	@param n the number of possible values
+*	@return a random number in [0, n)
+*/
+inline unsigned int randomBelow(RandomState& random, unsigned int n)
+{
+	return static_cast<unsigned int>(((nextRandom(random) >> 32) * n) >> 32);
+}
+
+/**	Returns a random number in [0, n), all with the same odds however large
+*	n is (Lemire's method: the top 64 bits of a 64 x 64-bit product, with the
+*	few products that would favor some values drawn again)
+*	@param random the generator
+*	@param n the number of possible values, not 0
+*	@return a random number in [0, n)
+*/
+inline uint64_t uniformBelow(RandomState& random, uint64_t n)
+{
+	unsigned __int128 product = static_cast<unsigned __int128>(nextRandom(random)) * n;
+	uint64_t low = static_cast<uint64_t>(product);
+	if (low < n)
+	{
+		//	2^64 mod n
+		uint64_t threshold = -n % n;
+		while (low < threshold)
+		{
+			product = static_cast<unsigned __int128>(nextRandom(random)) * n;
+			low = static_cast<uint64_t>(product);
+		}
+	}
+	return static_cast<uint64_t>(product >> 64);
+}
+
+/**	Assigns a distinct hue to each traveler
+*	@param numTravelers the number of travelers
+*	@return an array of numTravelers rgba colors, to be deleted by the caller
+*/
+float** createTravelerColors(unsigned int numTravelers);
+
 
 #endif //	DATAS_TYPES_H
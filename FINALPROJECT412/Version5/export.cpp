@@ -0,0 +1,269 @@
+//
+//  export.cpp
+//  Final Project CSC412
+//
+//	Shared-memory export of a running simulation (--export=name), so that
+//	viewers in other processes (traveler_viewer name) can draw it while the
+//	simulation itself runs headless, at full speed.  The simulation's grid is
+//	moved into the POSIX shared-memory segment /name before the travelers
+//	start, so the viewers read the live grid and publishing it costs nothing.
+//	A publisher thread copies the travelers (from their lock-free snapshots),
+//	the partitions and the counters into one of the segment's two frames
+//	every EXPORT_PERIOD, then bumps the segment's generation counter.
+//
+//	Each frame is a seqlock: its sequence counter is odd while it is written.
+//	A viewer copies the last frame published and starts over if its counter
+//	changed meanwhile.  Since the publisher writes the other frame next, that
+//	only happens to a viewer that took more than a whole period to copy it.
+//	The viewers map the segment read-only and the simulation never waits for
+//	them, so any number of them can attach without slowing it down.
+//
+//	A name in use by a running simulation is refused.  The segment of a
+//	simulation that was killed is replaced.  Only the user's own viewers can
+//	open it.
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <new>
+//
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <csignal>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+//
+#include "simulation.h"
+
+using namespace std;
+
+//-----------------------------------------------------------------------------
+//	Global variables
+//-----------------------------------------------------------------------------
+
+string exportName;
+bool exportEnabled = false;
+
+const char EXPORT_MAGIC[4] = {'T', 'R', 'V', 'X'};
+const uint32_t EXPORT_VERSION = 1;
+//	Time between two frames (in microseconds)
+const int EXPORT_PERIOD = 20000;
+
+ExportHeader* exportHeader = NULL;
+string exportShmName;
+
+pthread_t exportThread;
+atomic<bool> exportThreadQuit(false);
+
+//-----------------------------------------------------------------------------
+//	Private functions' prototypes
+//-----------------------------------------------------------------------------
+void* exportThreadFunc(void* arg);
+void publishFrame(void);
+bool exportOwnerDead(const string& shmName);
+void markExportFinished(void);
+
+
+//	true if the segment name is that of a simulation that was killed before
+//	it could remove it.  A segment that is not a simulation's is left alone.
+bool exportOwnerDead(const string& shmName)
+{
+	int fd = shm_open(shmName.c_str(), O_RDONLY, 0);
+	struct stat status;
+	if (fd < 0 || fstat(fd, &status) != 0 || status.st_size < (off_t) sizeof(ExportHeader))
+	{
+		if (fd >= 0)
+			close(fd);
+		return false;
+	}
+	void* mapping = mmap(NULL, sizeof(ExportHeader), PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (mapping == MAP_FAILED)
+		return false;
+	const ExportHeader* header = static_cast<const ExportHeader*>(mapping);
+	bool dead = memcmp(header->magic, EXPORT_MAGIC, sizeof(header->magic)) == 0 &&
+				(header->finished.load(memory_order_acquire) != 0 ||
+				 (kill(header->pid, 0) != 0 && errno == ESRCH));
+	munmap(mapping, sizeof(ExportHeader));
+	return dead;
+}
+
+//	Creates the segment, moves the grid into it and starts the publisher.
+//	To be called once the maze is built, before the travelers start.
+void openExport(void)
+{
+	exportShmName = (exportName[0] == '/') ? exportName : "/" + exportName;
+	size_t gridSize = (numRows + 2) * (size_t) gridStride;
+	//	Each segment of a traveler is on a square of its own
+	uint64_t maxSegments = min(numRows * (uint64_t) numCols, (uint64_t) UINT_MAX);
+	uint64_t frameSize = sizeof(ExportFrame) + numTravelers * sizeof(ExportTraveler) +
+						 partitionList.size() * sizeof(MazePartition) + maxSegments * sizeof(MazeSegment);
+	uint64_t gridOffset = pageAligned(sizeof(ExportHeader));
+	uint64_t frameOffset0 = pageAligned(gridOffset + gridSize);
+	uint64_t frameOffset1 = pageAligned(frameOffset0 + frameSize);
+	uint64_t size = frameOffset1 + frameSize;
+
+	//	The frames' segments are only backed by memory once written.  Only
+	//	the user's own viewers can open the segment.
+	int fd = shm_open(exportShmName.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+	if (fd < 0 && errno == EEXIST && exportOwnerDead(exportShmName))
+	{
+		shm_unlink(exportShmName.c_str());
+		fd = shm_open(exportShmName.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+	}
+	if (fd < 0 && errno == EEXIST)
+	{
+		fprintf(stderr, "%s is in use by another simulation\n", exportShmName.c_str());
+		exit(1);
+	}
+	void* mapping = MAP_FAILED;
+	if (fd >= 0 && ftruncate(fd, size) == 0)
+		mapping = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (fd >= 0)
+		close(fd);
+	if (mapping == MAP_FAILED)
+	{
+		perror(exportShmName.c_str());
+		exit(1);
+	}
+
+	char* base = static_cast<char*>(mapping);
+	exportHeader = new (base) ExportHeader();
+	memcpy(exportHeader->magic, EXPORT_MAGIC, sizeof(exportHeader->magic));
+	exportHeader->version = EXPORT_VERSION;
+	exportHeader->size = size;
+	exportHeader->numRows = numRows;
+	exportHeader->numCols = numCols;
+	exportHeader->gridStride = gridStride;
+	exportHeader->exitRow = exitPos.row;
+	exportHeader->exitCol = exitPos.col;
+	exportHeader->numTravelers = numTravelers;
+	exportHeader->numPartitions = partitionList.size();
+	exportHeader->maxSegments = maxSegments;
+	exportHeader->pid = getpid();
+	exportHeader->gridOffset = gridOffset;
+	exportHeader->frameOffset[0] = frameOffset0;
+	exportHeader->frameOffset[1] = frameOffset1;
+	new (base + frameOffset0) ExportFrame();
+	new (base + frameOffset1) ExportFrame();
+
+	//	From now on the grid is the segment's.  A maze file's grid stays in
+	//	its mapping until the file is unmapped.
+	memcpy(base + gridOffset, grid, gridSize);
+	if (mazePath.empty())
+		free(grid);
+	grid = reinterpret_cast<atomic<unsigned char>*>(base + gridOffset);
+	exportEnabled = true;
+
+	//	The GUI exits without freeing the simulation
+	static bool atExitSet = false;
+	if (!atExitSet)
+		atExitSet = atexit(markExportFinished) == 0;
+
+	publishFrame();
+	exportThreadQuit = false;
+	pthread_create(&exportThread, NULL, exportThreadFunc, NULL);
+}
+
+//	Once all travelers have terminated: publishes the final frame, then
+//	removes the segment and unmaps it, and the grid with it.  The viewers
+//	keep their mapping of the final state.
+void closeExport(void)
+{
+	if (!exportEnabled)
+		return;
+	exportThreadQuit = true;
+	pthread_join(exportThread, NULL);
+	publishFrame();
+	markExportFinished();
+	munmap(exportHeader, exportHeader->size);
+	exportHeader = NULL;
+	grid = NULL;
+	exportEnabled = false;
+}
+
+//	Tells the viewers the simulation has ended, and removes the segment's name
+void markExportFinished(void)
+{
+	if (exportHeader == NULL || exportHeader->finished.load(memory_order_relaxed))
+		return;
+	exportHeader->finished.store(1, memory_order_release);
+	shm_unlink(exportShmName.c_str());
+}
+
+inline ExportFrame* exportFrame(unsigned int k)
+{
+	return reinterpret_cast<ExportFrame*>(reinterpret_cast<char*>(exportHeader) + exportHeader->frameOffset[k]);
+}
+
+//	Writes the frame that wasn't published last, then publishes it
+void publishFrame(void)
+{
+	static vector<TravelerSegment> body;
+	Traveler traveler;
+
+	uint64_t generation = exportHeader->generation.load(memory_order_relaxed);
+	ExportFrame* frame = exportFrame((generation + 1) % 2);
+	ExportTraveler* frameTravelers = reinterpret_cast<ExportTraveler*>(frame + 1);
+	MazePartition* framePartitions = reinterpret_cast<MazePartition*>(frameTravelers + exportHeader->numTravelers);
+	MazeSegment* frameSegments = reinterpret_cast<MazeSegment*>(framePartitions + exportHeader->numPartitions);
+
+	//	The frame's single writer needs no atomic increment
+	frame->seq.store(frame->seq.load(memory_order_relaxed) + 1, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+
+	lockMutex(&globalLock, GLOBAL_LOCK);
+		frame->numTravelersDone = numTravelersDone;
+		frame->numLiveThreads = numLiveThreads;
+		frame->travelerSleepTime = travelerSleepTime;
+	unlockMutex(&globalLock, GLOBAL_LOCK);
+	frame->runTime = runTimeSeconds();
+
+	uint32_t numSegments = 0;
+	for (unsigned int k = 0; k < exportHeader->numTravelers; k++)
+	{
+		unsigned int length = snapshotTraveler(k, traveler, body);
+		//	The snapshots are not all taken at the same time, so in theory
+		//	they could hold more segments than there are squares
+		length = min(length, exportHeader->maxSegments - numSegments);
+		ExportTraveler& exported = frameTravelers[k];
+		exported.length = length;
+		exported.firstSegment = numSegments;
+		memcpy(exported.rgba, travelers.rgba + 4*k, sizeof(exported.rgba));
+		for (unsigned int i = 0; i < length; i++)
+		{
+			const TravelerSegment& segment = segmentAt(traveler, i);
+			MazeSegment& saved = frameSegments[numSegments++];
+			saved.row = segment.row;
+			saved.col = segment.col;
+			saved.dir = segment.dir;
+		}
+	}
+	frame->numSegments = numSegments;
+
+	for (unsigned int k = 0; k < exportHeader->numPartitions; k++)
+	{
+		SlidingPartition partition = getPartition(k);
+		framePartitions[k].isVertical = partition.isVertical;
+		framePartitions[k].startRow = partition.start.row;
+		framePartitions[k].startCol = partition.start.col;
+		framePartitions[k].length = partition.length;
+	}
+
+	frame->seq.store(frame->seq.load(memory_order_relaxed) + 1, memory_order_release);
+	exportHeader->generation.store(generation + 1, memory_order_release);
+}
+
+void* exportThreadFunc(void* arg)
+{
+	while (!exportThreadQuit.load(memory_order_relaxed))
+	{
+		usleep(EXPORT_PERIOD);
+		publishFrame();
+	}
+	return NULL;
+}
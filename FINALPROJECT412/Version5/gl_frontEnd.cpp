@@ -22,6 +22,8 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <math.h>
+#include <vector>
+#include <algorithm>
 //
 #include "gl_frontEnd.h"
 
@@ -29,10 +31,10 @@
 const extern int MAX_NUM_MESSAGES;
 const extern int MAX_LENGTH_MESSAGE;
 
-extern SquareType** grid;
 extern unsigned int numRows;			//	height of the grid
 extern unsigned int numCols;			//	width
 extern unsigned int numLiveThreads;		//	the number of live traveler threads
+extern GridPosition exitPos;			//	location of the exit
 
 
 //-----------------------------------------------------------------------------
@@ -53,9 +55,20 @@ void myResize(int w, int h);
 void displayTextualInfo(const char* infoStr, int x, int y, FontSize fontSize);
 void myMouse(int b, int s, int x, int y);
 void myGridPaneMouse(int b, int s, int x, int y);
+void myGridPaneMotion(int x, int y);
 void myStatePaneMouse(int b, int s, int x, int y);
 void myKeyboard(unsigned char c, int x, int y);
 void myTimerFunc(int val);
+void compileStaticGrid(void);
+void drawStaticSquares(unsigned int firstRow, unsigned int lastRow,
+					   unsigned int firstCol, unsigned int lastCol, bool gridLines);
+void buildWallDensity(void);
+void fillDensityImage(unsigned int firstRow, unsigned int lastRow,
+					  unsigned int firstCol, unsigned int lastCol);
+void plotDensity(unsigned int row, unsigned int col, const float color[], int radius);
+void drawDensityImage(void);
+void clampView(void);
+void zoomView(float factor, int x, int y);
 void createtravelerColors(void);
 void freetravelerColors(void);
 
@@ -75,6 +88,20 @@ const float TEXT_COLOR[4] = {1.f, 1.f, 1.f, 1.f};
 const float WALL_COLOR[4] = {0.6f, 0.3f, 0.1f, 1.f};
 const float PART_COLOR[4] = {0.6f, 0.6f, 0.6f, 1.f};
 const float EXIT_COLOR[4] = {1.f, 1.f, 1.f, 1.f};
+//	in pixels, so that a segment looks like the 1-pixel line it used to be
+const float SEGMENT_HALF_WIDTH = 0.5f;
+
+//	Largest zoom of the grid pane, as the size of a square in pixels
+const float MAX_SQUARE_SIZE = 64.f;
+//	Zoom factor of a step of the mouse wheel or a press of '+' or '-'
+const float ZOOM_STEP = 1.25f;
+//	The grid lines are only drawn if they are at least that many pixels apart
+const float MIN_GRID_LINE_SPACING = 4.f;
+//	Size of the density view's texture: a power of 2, at least the grid pane's
+const int DENSITY_TEXTURE_SIZE = 1024;
+//	glut reports the steps of the mouse wheel as presses of these buttons
+const int WHEEL_UP_BUTTON = 3,
+		  WHEEL_DOWN_BUTTON = 4;
 
 const int   INIT_WIN_X = 50,
             INIT_WIN_Y = 40;
@@ -111,6 +138,29 @@ int	gMainWindow,
 
 GLfloat** travelerColor;
 
+//	Display list of the grid's static geometry (0 until compiled)
+GLuint staticGridList = 0;
+
+//	Pan and zoom of the grid pane.  The grid is laid out to fit the pane, and
+//	the pane shows the part of that layout starting at (viewX, viewY),
+//	magnified viewZoom times.
+float viewZoom = 1.f;
+float viewX = 0.f,
+	  viewY = 0.f;
+//	Last position of the mouse while the grid pane is dragged (-1 otherwise)
+int dragX = -1,
+	dragY = -1;
+
+//	When a pixel covers several squares, the grid pane is drawn as an image
+//	with a texel per pixel, aggregating the squares under it, so that the
+//	cost of a frame depends on the size of the pane, not that of the grid.
+GLuint densityTexture = 0;
+std::vector<GLubyte> densityImage;		//	r, g, b
+//	Fraction of walls (0 to 255) of the blocks of 2^l x 2^l squares, for the
+//	levels l = 1, 2, ..., built the first time the density view is drawn
+std::vector< std::vector<GLubyte> > wallDensity;
+bool wallDensityBuilt = false;
+
 //---------------------------------------------------------------------------
 #if 0
 #pragma mark -
@@ -118,6 +168,25 @@ GLfloat** travelerColor;
 #endif
 //---------------------------------------------------------------------------
 
+//	All the travelers of a frame are gathered into one array of colored
+//	triangles, sent to OpenGL with a single draw call by drawTravelerBatch.
+//	A traveler's head is a small diamond (2 triangles), and each of its segments
+//	a thin rectangle (2 triangles) from the center of a square to the next.
+std::vector<GLfloat> batchVertices;		//	x, y
+std::vector<GLubyte> batchColors;		//	r, g, b, a
+
+//	Adds a rectangle of half-width SEGMENT_HALF_WIDTH (in pixels, at any zoom)
+//	from (x, y) to (x+dx, y+dy), dx or dy being 0
+void addSegmentToBatch(GLfloat x, GLfloat y, GLfloat dx, GLfloat dy)
+{
+	const GLfloat halfWidth = SEGMENT_HALF_WIDTH / viewZoom;
+	const GLfloat wx = (dx == 0.f) ? halfWidth : 0.f,
+				  wy = (dy == 0.f) ? halfWidth : 0.f;
+	const GLfloat quad[12] = {	x-wx, y-wy,		x+dx-wx, y+dy-wy,	x+dx+wx, y+dy+wy,
+								x-wx, y-wy,		x+dx+wx, y+dy+wy,	x+wx, y+wy};
+	batchVertices.insert(batchVertices.end(), quad, quad + 12);
+}
+
 void drawTraveler(const Traveler& traveler)
 {
 	//	Yes, I know that it's inefficient to recompute this each and every time,
@@ -130,58 +199,158 @@ void drawTraveler(const Traveler& traveler)
 								{0, -DV},	//	SOUTH
 								{-DH, 0}};	//	EAST
 
-	glColor4fv(traveler.rgba);
-	glPushMatrix();
+	size_t firstVertex = batchVertices.size() / 2;
+
 	//	The first segment is different
-	glTranslatef((traveler.segmentList[0].col + 0.5f)*DH,
-				 (traveler.segmentList[0].row + 0.5f)*DV, 0.f);
+	const TravelerSegment& headSeg = segmentAt(traveler, 0);
+	GLfloat x = (headSeg.col + 0.5f)*DH,
+			y = (headSeg.row + 0.5f)*DV;
 	//	draw the "head"
-	glPushMatrix();
-	glScalef(0.2f, 0.2f, 1.f);
-	glBegin(GL_POLYGON);
-		glVertex2f(0, DV);
-		glVertex2f(-DH, 0);
-		glVertex2f(0, -DV);
-		glVertex2f(DH, 0);
-	glEnd();
-	glPopMatrix();
-	if (traveler.segmentList.size() > 1)
+	const GLfloat hx = 0.2f*DH, hy = 0.2f*DV;
+	const GLfloat head[12] = {	x, y+hy,	x-hx, y,	x, y-hy,
+								x, y+hy,	x, y-hy,	x+hx, y};
+	batchVertices.insert(batchVertices.end(), head, head + 12);
+	if (traveler.length > 1)
 	{
-		for (unsigned int currSegIndex=0; currSegIndex<traveler.segmentList.size()-1; currSegIndex++)
+		for (unsigned int currSegIndex=0; currSegIndex<traveler.length-1; currSegIndex++)
 		{
+			Direction dir = segmentAt(traveler, currSegIndex).dir;
 			//	draw a segment to the center of the next square
-			glBegin(GL_LINES);
-				glVertex2f(0, 0);
-				glVertex2f(segMove[traveler.segmentList[currSegIndex].dir][0],
-						   segMove[traveler.segmentList[currSegIndex].dir][1]);
-			glEnd();
-			
+			addSegmentToBatch(x, y, segMove[dir][0], segMove[dir][1]);
 			//	and move to that point
-			glTranslatef(segMove[traveler.segmentList[currSegIndex].dir][0],
-						 segMove[traveler.segmentList[currSegIndex].dir][1],
-						 0.f);
-
+			x += segMove[dir][0];
+			y += segMove[dir][1];
 		}
 		//	The last segment is a bit shorter
-		glBegin(GL_LINES);
-			glVertex2f(0, 0);
-			glVertex2f(segMove[traveler.segmentList[traveler.segmentList.size()-1].dir][0]*0.8f,
-					   segMove[traveler.segmentList[traveler.segmentList.size()-1].dir][1]*0.8f);
-		glEnd();
+		Direction lastDir = segmentAt(traveler, traveler.length-1).dir;
+		addSegmentToBatch(x, y, segMove[lastDir][0]*0.8f, segMove[lastDir][1]*0.8f);
 	}
 	else
 	{
 		//	draw the only segment
+		addSegmentToBatch(x, y, segMove[headSeg.dir][0]*0.4f, segMove[headSeg.dir][1]*0.4f);
+	}
+
+	//	All the vertices of the traveler get its color
+	GLubyte rgba[4];
+	for (int k=0; k<4; k++)
+		rgba[k] = static_cast<GLubyte>(255.f * traveler.rgba[k]);
+	for (size_t v=firstVertex; v<batchVertices.size()/2; v++)
+		batchColors.insert(batchColors.end(), rgba, rgba + 4);
+}
+
+void drawTravelerBatch(void)
+{
+	if (!batchVertices.empty())
+	{
+		glEnableClientState(GL_VERTEX_ARRAY);
+		glEnableClientState(GL_COLOR_ARRAY);
+		glVertexPointer(2, GL_FLOAT, 0, batchVertices.data());
+		glColorPointer(4, GL_UNSIGNED_BYTE, 0, batchColors.data());
+		glDrawArrays(GL_TRIANGLES, 0, batchVertices.size() / 2);
+		glDisableClientState(GL_COLOR_ARRAY);
+		glDisableClientState(GL_VERTEX_ARRAY);
+	}
+	//	The arrays keep their capacity from one frame to the next
+	batchVertices.clear();
+	batchColors.clear();
+}
+
+
+//	Walls, the exit and the grid lines never change, so on a grid that has no
+//	more squares than the pane has pixels they are compiled once into a
+//	display list (in the grid pane's context, the first time the grid is
+//	drawn).  A larger grid only gets the squares in view drawn.
+void compileStaticGrid(void)
+{
+	staticGridList = glGenLists(1);
+	glNewList(staticGridList, GL_COMPILE);
+	drawStaticSquares(0, numRows-1, 0, numCols-1, true);
+	glEndList();
+}
+
+//	Draws the walls, the exit and the grid lines of a range of squares.
+//	Each row's runs of walls are merged into a single quad.
+void drawStaticSquares(unsigned int firstRow, unsigned int lastRow,
+					   unsigned int firstCol, unsigned int lastCol, bool gridLines)
+{
+	const GLfloat	DH = (GRID_PANE_WIDTH - 2.f)/ numCols,
+					DV = (GRID_PANE_HEIGHT - 2.f) / numRows;
+
+	//	draw the walls
+	glColor4fv(WALL_COLOR);
+	glBegin(GL_QUADS);
+	for (unsigned int i=firstRow; i<=lastRow; i++)
+	{
+		unsigned int j = firstCol;
+		while (j <= lastCol)
+		{
+			if (getSquare(i, j) != WALL)
+			{
+				j++;
+				continue;
+			}
+			unsigned int runStart = j;
+			while (j <= lastCol && getSquare(i, j) == WALL)
+				j++;
+			glVertex2f(runStart*DH, i*DV);
+			glVertex2f(j*DH, i*DV);
+			glVertex2f(j*DH, (i+1)*DV);
+			glVertex2f(runStart*DH, (i+1)*DV);
+		}
+	}
+	glEnd();
+
+	//	draw the exit
+	const unsigned int ei = exitPos.row, ej = exitPos.col;
+	if (ei >= firstRow && ei <= lastRow && ej >= firstCol && ej <= lastCol)
+	{
+		glColor4fv(EXIT_COLOR);
+		glBegin(GL_POLYGON);
+			glVertex2f(ej*DH, ei*DV);
+			glVertex2f((ej+1)*DH, ei*DV);
+			glVertex2f((ej+1)*DH, (ei+1)*DV);
+			glVertex2f(ej*DH, (ei+1)*DV);
+		glEnd();
+		glColor4f(0.f, 0.f, 0.f, 1.f);
 		glBegin(GL_LINES);
-			glVertex2f(0, 0);
-			glVertex2f(segMove[traveler.segmentList[0].dir][0]*0.4f,
-					   segMove[traveler.segmentList[0].dir][1]*0.4f);
-		glEnd();	}
-	
-	glPopMatrix();
+			glVertex2f(ej*DH, ei*DV);
+			glVertex2f((ej+1)*DH, (ei+1)*DV);
+			glVertex2f((ej+1)*DH, ei*DV);
+			glVertex2f(ej*DH, (ei+1)*DV);
+		glEnd();
+	}
 
+	//	Then draw a grid of lines on top of the squares
+	if (gridLines)
+	{
+		glColor4f(0.5f, 0.5f, 0.5f, 1.f);
+		glBegin(GL_LINES);
+			//	Horizontal
+			for (unsigned int i=firstRow; i<= lastRow+1; i++)
+			{
+				glVertex2f(1.f + firstCol*DH, 1.f + i*DV);
+				glVertex2f(1.f + (lastCol+1)*DH, 1.f + i*DV);
+			}
+			//	Vertical
+			for (unsigned int j=firstCol; j<= lastCol+1; j++)
+			{
+				glVertex2f(1.f + j*DH, 1.f + firstRow*DV);
+				glVertex2f(1.f + j*DH, 1.f + (lastRow+1)*DV);
+			}
+		glEnd();
+	}
 }
 
+//	true if some square of the partition is in the range of squares
+inline bool partitionInRange(const SlidingPartition& partition, unsigned int firstRow, unsigned int lastRow,
+							 unsigned int firstCol, unsigned int lastCol)
+{
+	const unsigned int i = partition.start.row, j = partition.start.col;
+	const unsigned int endRow = partition.isVertical ? i + partition.length - 1 : i,
+					   endCol = partition.isVertical ? j : j + partition.length - 1;
+	return endRow >= firstRow && i <= lastRow && endCol >= firstCol && j <= lastCol;
+}
 
 //	This is the function that does the actual grid drawing
 void drawGrid(void)
@@ -190,85 +359,266 @@ void drawGrid(void)
 					DV = (GRID_PANE_HEIGHT - 2.f) / numRows;
 	const GLfloat	PS = 0.3f, PE = 1.f - PS;
 
-	//	draw the walls and partitions
-	for (unsigned int i=0; i< numRows; i++)
+	unsigned int firstRow, lastRow, firstCol, lastCol;
+	getVisibleSquares(firstRow, lastRow, firstCol, lastCol);
+	if (isDensityView())
+	{
+		fillDensityImage(firstRow, lastRow, firstCol, lastCol);
+		return;
+	}
+
+	//	draw the partitions in view, one quad each, from their current extents
+	glColor4fv(PART_COLOR);
+	glBegin(GL_QUADS);
+	unsigned int numPartitions = getNumPartitions();
+	for (unsigned int k=0; k<numPartitions; k++)
 	{
-		for (unsigned int j=0; j< numCols; j++)
+		SlidingPartition partition = getPartition(k);
+		if (!partitionInRange(partition, firstRow, lastRow, firstCol, lastCol))
+			continue;
+		const unsigned int i = partition.start.row, j = partition.start.col;
+		if (partition.isVertical)
+		{
+			glVertex2f((j+PS)*DH, i*DV);
+			glVertex2f((j+PE)*DH, i*DV);
+			glVertex2f((j+PE)*DH, (i+partition.length)*DV);
+			glVertex2f((j+PS)*DH, (i+partition.length)*DV);
+		}
+		else
 		{
-			switch (grid[i][j])
+			glVertex2f(j*DH, (i+PS)*DV);
+			glVertex2f((j+partition.length)*DH, (i+PS)*DV);
+			glVertex2f((j+partition.length)*DH, (i+PE)*DV);
+			glVertex2f(j*DH, (i+PE)*DV);
+		}
+	}
+	glEnd();
+
+	if (numRows * (size_t) numCols <= GRID_PANE_WIDTH * (size_t) GRID_PANE_HEIGHT)
+	{
+		if (staticGridList == 0)
+			compileStaticGrid();
+		glCallList(staticGridList);
+	}
+	else
+		drawStaticSquares(firstRow, lastRow, firstCol, lastCol,
+						  std::min(DH, DV) * viewZoom >= MIN_GRID_LINE_SPACING);
+}
+
+//---------------------------------------------------------------------------
+#if 0
+#pragma mark -
+#pragma mark Density View
+#endif
+//---------------------------------------------------------------------------
+
+//	The number of rows and columns of blocks of 2^level x 2^level squares
+inline void getLevelSize(unsigned int level, unsigned int& rows, unsigned int& cols)
+{
+	rows = (numRows + (1U << level) - 1) >> level;
+	cols = (numCols + (1U << level) - 1) >> level;
+}
+
+//	Builds the levels of wallDensity, each from the one below, up to blocks
+//	of as many squares as a pixel covers when the whole grid is shown.  This
+//	is only done once, since walls never change.
+void buildWallDensity(void)
+{
+	const GLfloat	DH = (GRID_PANE_WIDTH - 2.f)/ numCols,
+					DV = (GRID_PANE_HEIGHT - 2.f) / numRows;
+	const float maxSquaresPerPixel = 1.f / std::min(DH, DV);
+
+	for (unsigned int level=1; (1U << level) <= maxSquaresPerPixel; level++)
+	{
+		unsigned int rows, cols, lowerRows, lowerCols;
+		getLevelSize(level, rows, cols);
+		getLevelSize(level-1, lowerRows, lowerCols);
+		wallDensity.push_back(std::vector<GLubyte>(rows * (size_t) cols));
+		std::vector<GLubyte>& density = wallDensity.back();
+		for (unsigned int i=0; i<rows; i++)
+			for (unsigned int j=0; j<cols; j++)
 			{
-				case WALL:
-					glColor4fv(WALL_COLOR);
-					glBegin(GL_POLYGON);
-						glVertex2f(j*DH, i*DV);
-						glVertex2f((j+1)*DH, i*DV);
-						glVertex2f((j+1)*DH, (i+1)*DV);
-						glVertex2f(j*DH, (i+1)*DV);
-					glEnd();
-					break;
-					
-					
-				case VERTICAL_PARTITION:
-					glColor4fv(PART_COLOR);
-					glBegin(GL_POLYGON);
-						glVertex2f((j+PS)*DH, i*DV);
-						glVertex2f((j+PE)*DH, i*DV);
-						glVertex2f((j+PE)*DH, (i+1)*DV);
-						glVertex2f((j+PS)*DH, (i+1)*DV);
-					glEnd();
-					break;
-					
-				case HORIZONTAL_PARTITION:
-					glColor4fv(PART_COLOR);
-					glBegin(GL_POLYGON);
-						glVertex2f(j*DH, (i+PS)*DV);
-						glVertex2f((j+1)*DH, (i+PS)*DV);
-						glVertex2f((j+1)*DH, (i+PE)*DV);
-						glVertex2f(j*DH, (i+PE)*DV);
-					glEnd();
-					break;
-					
-				case EXIT:
-					glColor4fv(EXIT_COLOR);
-					glBegin(GL_POLYGON);
-						glVertex2f(j*DH, i*DV);
-						glVertex2f((j+1)*DH, i*DV);
-						glVertex2f((j+1)*DH, (i+1)*DV);
-						glVertex2f(j*DH, (i+1)*DV);
-					glEnd();
-					glColor4f(0.f, 0.f, 0.f, 1.f);
-					glBegin(GL_LINES);
-						glVertex2f(j*DH, i*DV);
-						glVertex2f((j+1)*DH, (i+1)*DV);
-						glVertex2f((j+1)*DH, i*DV);
-						glVertex2f(j*DH, (i+1)*DV);
-					glEnd();
-					break;
-				
-				default:
-					//	nothing
-					break;
+				//	the average of the (up to) 4 squares or blocks below
+				unsigned int sum = 0, count = 0;
+				for (unsigned int r=2*i; r<2*i+2 && r<lowerRows; r++)
+					for (unsigned int c=2*j; c<2*j+2 && c<lowerCols; c++)
+					{
+						if (level == 1)
+							sum += (getSquare(r, c) == WALL) ? 255 : 0;
+						else
+							sum += wallDensity[level-2][r * (size_t) lowerCols + c];
+						count++;
+					}
+				density[i * (size_t) cols + j] = static_cast<GLubyte>(sum / count);
 			}
-		}
 	}
-	
-	//	Then draw a grid of lines on top of the squares
-	glColor4f(0.5f, 0.5f, 0.5f, 1.f);
-	glBegin(GL_LINES);
-		//	Horizontal
-		for (unsigned int i=0; i<= numRows+1; i++)
+	wallDensityBuilt = true;
+}
+
+//	Colors the pixel of a square, and those within radius of it
+void plotDensity(unsigned int row, unsigned int col, const float color[], int radius)
+{
+	const GLfloat	DH = (GRID_PANE_WIDTH - 2.f)/ numCols,
+					DV = (GRID_PANE_HEIGHT - 2.f) / numRows;
+	const int x = static_cast<int>(floorf(((col + 0.5f)*DH - viewX) * viewZoom)),
+			  y = static_cast<int>(floorf(((row + 0.5f)*DV - viewY) * viewZoom));
+	GLubyte rgb[3];
+	for (int k=0; k<3; k++)
+		rgb[k] = static_cast<GLubyte>(255.f * color[k]);
+	for (int py=std::max(y-radius, 0); py<=y+radius && py<GRID_PANE_HEIGHT; py++)
+		for (int px=std::max(x-radius, 0); px<=x+radius && px<GRID_PANE_WIDTH; px++)
 		{
-			glVertex2f(1.f, 1.f + i*DV);
-			glVertex2f(1.f + numCols*DH, 1.f + i*DV);
+			GLubyte* pixel = &densityImage[3 * (py * GRID_PANE_WIDTH + px)];
+			pixel[0] = rgb[0];
+			pixel[1] = rgb[1];
+			pixel[2] = rgb[2];
 		}
-		//	Vertical
-		for (unsigned int j=0; j<= numCols+1; j++)
+}
+
+//	Fills the density image with the walls, partitions and exit.  Each pixel
+//	takes its walls from the level of wallDensity whose blocks are closest to
+//	(but no larger than) the squares under the pixel, so a frame costs the
+//	same whatever the size of the grid.
+void fillDensityImage(unsigned int firstRow, unsigned int lastRow,
+					  unsigned int firstCol, unsigned int lastCol)
+{
+	const GLfloat	DH = (GRID_PANE_WIDTH - 2.f)/ numCols,
+					DV = (GRID_PANE_HEIGHT - 2.f) / numRows;
+
+	if (!wallDensityBuilt)
+		buildWallDensity();
+	densityImage.assign(3 * GRID_PANE_WIDTH * GRID_PANE_HEIGHT, 0);
+
+	const float squaresPerPixel = 1.f / (std::min(DH, DV) * viewZoom);
+	unsigned int level = 0;
+	while (level < wallDensity.size() && (2U << level) <= squaresPerPixel)
+		level++;
+	unsigned int levelRows, levelCols;
+	getLevelSize(level, levelRows, levelCols);
+
+	//	The column of the square at the center of each column of pixels
+	static std::vector<unsigned int> pixelCol(GRID_PANE_WIDTH);
+	for (int x=0; x<GRID_PANE_WIDTH; x++)
+		pixelCol[x] = static_cast<unsigned int>((viewX + (x + 0.5f) / viewZoom) / DH);
+
+	for (int y=0; y<GRID_PANE_HEIGHT; y++)
+	{
+		const unsigned int row = static_cast<unsigned int>((viewY + (y + 0.5f) / viewZoom) / DV);
+		if (row >= numRows)
+			break;
+		GLubyte* pixel = &densityImage[3 * y * GRID_PANE_WIDTH];
+		for (int x=0; x<GRID_PANE_WIDTH && pixelCol[x]<numCols; x++, pixel+=3)
 		{
-			glVertex2f(1.f + j*DH, 1.f);
-			glVertex2f(1.f + j*DH, 1.f + numRows*DV);
+			const unsigned int col = pixelCol[x];
+			const float walls = (level == 0) ? ((getSquare(row, col) == WALL) ? 255.f : 0.f)
+								: wallDensity[level-1][(row >> level) * (size_t) levelCols + (col >> level)];
+			pixel[0] = static_cast<GLubyte>(WALL_COLOR[0] * walls);
+			pixel[1] = static_cast<GLubyte>(WALL_COLOR[1] * walls);
+			pixel[2] = static_cast<GLubyte>(WALL_COLOR[2] * walls);
 		}
+	}
+
+	//	A partition is plotted every pixel or so along its length
+	const unsigned int step = std::max(1U, static_cast<unsigned int>(squaresPerPixel));
+	unsigned int numPartitions = getNumPartitions();
+	for (unsigned int k=0; k<numPartitions; k++)
+	{
+		SlidingPartition partition = getPartition(k);
+		if (!partitionInRange(partition, firstRow, lastRow, firstCol, lastCol))
+			continue;
+		for (unsigned int t=0; t<partition.length; t+=step)
+			plotDensity(partition.start.row + (partition.isVertical ? t : 0),
+						partition.start.col + (partition.isVertical ? 0 : t), PART_COLOR, 0);
+	}
+
+	if (exitPos.row >= firstRow && exitPos.row <= lastRow && exitPos.col >= firstCol && exitPos.col <= lastCol)
+		plotDensity(exitPos.row, exitPos.col, EXIT_COLOR, 1);
+}
+
+void drawTravelerHead(unsigned int row, unsigned int col, const float rgba[4])
+{
+	plotDensity(row, col, rgba, 1);
+}
+
+//	Draws the density image over the whole grid pane
+void drawDensityImage(void)
+{
+	if (densityTexture == 0)
+	{
+		glGenTextures(1, &densityTexture);
+		glBindTexture(GL_TEXTURE_2D, densityTexture);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, DENSITY_TEXTURE_SIZE, DENSITY_TEXTURE_SIZE, 0,
+					 GL_RGB, GL_UNSIGNED_BYTE, NULL);
+	}
+	glBindTexture(GL_TEXTURE_2D, densityTexture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, GRID_PANE_WIDTH, GRID_PANE_HEIGHT,
+					GL_RGB, GL_UNSIGNED_BYTE, densityImage.data());
+	glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
+
+	const GLfloat	S = static_cast<GLfloat>(GRID_PANE_WIDTH) / DENSITY_TEXTURE_SIZE,
+					T = static_cast<GLfloat>(GRID_PANE_HEIGHT) / DENSITY_TEXTURE_SIZE;
+	glEnable(GL_TEXTURE_2D);
+	glBegin(GL_QUADS);
+		glTexCoord2f(0.f, 0.f);
+		glVertex2f(0.f, 0.f);
+		glTexCoord2f(S, 0.f);
+		glVertex2f(GRID_PANE_WIDTH, 0.f);
+		glTexCoord2f(S, T);
+		glVertex2f(GRID_PANE_WIDTH, GRID_PANE_HEIGHT);
+		glTexCoord2f(0.f, T);
+		glVertex2f(0.f, GRID_PANE_HEIGHT);
 	glEnd();
-	
+	glDisable(GL_TEXTURE_2D);
+}
+
+//---------------------------------------------------------------------------
+#if 0
+#pragma mark -
+#pragma mark Pan and Zoom
+#endif
+//---------------------------------------------------------------------------
+
+void getVisibleSquares(unsigned int& firstRow, unsigned int& lastRow,
+					   unsigned int& firstCol, unsigned int& lastCol)
+{
+	const GLfloat	DH = (GRID_PANE_WIDTH - 2.f)/ numCols,
+					DV = (GRID_PANE_HEIGHT - 2.f) / numRows;
+	lastRow = std::min(numRows - 1, static_cast<unsigned int>((viewY + GRID_PANE_HEIGHT / viewZoom) / DV));
+	lastCol = std::min(numCols - 1, static_cast<unsigned int>((viewX + GRID_PANE_WIDTH / viewZoom) / DH));
+	firstRow = std::min(lastRow, static_cast<unsigned int>(viewY / DV));
+	firstCol = std::min(lastCol, static_cast<unsigned int>(viewX / DH));
+}
+
+bool isDensityView(void)
+{
+	const GLfloat	DH = (GRID_PANE_WIDTH - 2.f)/ numCols,
+					DV = (GRID_PANE_HEIGHT - 2.f) / numRows;
+	return std::min(DH, DV) * viewZoom < 1.f;
+}
+
+//	Keeps the view within the grid
+void clampView(void)
+{
+	viewX = std::max(0.f, std::min(viewX, GRID_PANE_WIDTH * (1.f - 1.f / viewZoom)));
+	viewY = std::max(0.f, std::min(viewY, GRID_PANE_HEIGHT * (1.f - 1.f / viewZoom)));
+}
+
+//	Zooms the grid pane by factor, keeping in place the point under the pixel
+//	(x, y) of the pane.  The zoom goes from the whole grid to squares of
+//	MAX_SQUARE_SIZE pixels.
+void zoomView(float factor, int x, int y)
+{
+	const GLfloat	DH = (GRID_PANE_WIDTH - 2.f)/ numCols,
+					DV = (GRID_PANE_HEIGHT - 2.f) / numRows;
+	const float maxZoom = std::max(1.f, MAX_SQUARE_SIZE / std::min(DH, DV));
+	const float zoom = std::max(1.f, std::min(viewZoom * factor, maxZoom));
+	viewX += x / viewZoom - x / zoom;
+	viewY += y / viewZoom - y / zoom;
+	viewZoom = zoom;
+	clampView();
 }
 
 
@@ -432,10 +782,23 @@ void displayGridPane(void)
 
 	glTranslatef(0, GRID_PANE_HEIGHT, 0);
 	glScalef(1.f, -1.f, 1.f);
-	
-	drawTravelers();
-	
-	drawGrid();
+
+	if (isDensityView())
+	{
+		//	the grid, then the travelers' heads, go into the density image
+		drawGrid();
+		drawTravelers();
+		drawDensityImage();
+	}
+	else
+	{
+		glScalef(viewZoom, viewZoom, 1.f);
+		glTranslatef(-viewX, -viewY, 0.f);
+
+		drawTravelers();
+
+		drawGrid();
+	}
 
 	//	This is OpenGL/glut magic.  Don't touch
 	glutSwapBuffers();
@@ -482,7 +845,8 @@ void myMouse(int button, int state, int x, int y)
 	glutPostRedisplay();
 }
 
-//	This function is called when a mouse event occurs in the grid pane
+//	This function is called when a mouse event occurs in the grid pane.
+//	Dragging pans the grid, and the wheel zooms it around the mouse.
 //
 void myGridPaneMouse(int button, int state, int x, int y)
 {
@@ -491,14 +855,25 @@ void myGridPaneMouse(int button, int state, int x, int y)
 		case GLUT_LEFT_BUTTON:
 			if (state == GLUT_DOWN)
 			{
-				//	do something
+				dragX = x;
+				dragY = y;
 			}
 			else if (state == GLUT_UP)
 			{
-				//	exit(0);
+				dragX = dragY = -1;
 			}
 			break;
 
+		case WHEEL_UP_BUTTON:
+			if (state == GLUT_DOWN)
+				zoomView(ZOOM_STEP, x, y);
+			break;
+
+		case WHEEL_DOWN_BUTTON:
+			if (state == GLUT_DOWN)
+				zoomView(1.f / ZOOM_STEP, x, y);
+			break;
+
 		default:
 			break;
 	}
@@ -507,6 +882,23 @@ void myGridPaneMouse(int button, int state, int x, int y)
 	glutPostRedisplay();
 }
 
+//	This function is called when the mouse moves in the grid pane with a
+//	button pressed
+//
+void myGridPaneMotion(int x, int y)
+{
+	if (dragX < 0)
+		return;
+	viewX -= (x - dragX) / viewZoom;
+	viewY -= (y - dragY) / viewZoom;
+	dragX = x;
+	dragY = y;
+	clampView();
+
+	glutSetWindow(gMainWindow);
+	glutPostRedisplay();
+}
+
 //	This function is called when a mouse event occurs in the state pane
 void myStatePaneMouse(int button, int state, int x, int y)
 {
@@ -532,11 +924,31 @@ void myStatePaneMouse(int button, int state, int x, int y)
 }
 
 
-//	This callback function is called when a keyboard event occurs
+//	This callback function is called when a keyboard event occurs.
+//	'+' and '-' zoom the grid pane around its center, '0' shows the whole grid.
 //
 void myKeyboard(unsigned char c, int x, int y)
 {
-	handleKeyboardEvent(c, x, y);
+	switch (c)
+	{
+		case '+':
+		case '=':
+			zoomView(ZOOM_STEP, GRID_PANE_WIDTH / 2, GRID_PANE_HEIGHT / 2);
+			break;
+
+		case '-':
+			zoomView(1.f / ZOOM_STEP, GRID_PANE_WIDTH / 2, GRID_PANE_HEIGHT / 2);
+			break;
+
+		case '0':
+			viewZoom = 1.f;
+			viewX = viewY = 0.f;
+			break;
+
+		default:
+			handleKeyboardEvent(c, x, y);
+			break;
+	}
 	glutSetWindow(gMainWindow);
 	glutPostRedisplay();
 }
@@ -594,6 +1006,7 @@ void initializeFrontEnd(int argc, char** argv)
 	glClearColor(0.f, 0.f, 0.f, 1.f);
 	glutKeyboardFunc(myKeyboard);
 	glutMouseFunc(myGridPaneMouse);
+	glutMotionFunc(myGridPaneMotion);
 	glutDisplayFunc(displayGridPane);
 
 
@@ -607,74 +1020,6 @@ void initializeFrontEnd(int argc, char** argv)
 	glOrtho(0.0f, STATE_PANE_WIDTH, 0.0f, STATE_PANE_HEIGHT, -1, 1);
 	glClearColor(0.f, 0.f, 0.f, 1.f);
 	glutKeyboardFunc(myKeyboard);
-	glutMouseFunc(myGridPaneMouse);
+	glutMouseFunc(myStatePaneMouse);
 	glutDisplayFunc(displayStatePane);
 }
-
-float** createTravelerColors(unsigned int numTravelers)
-{
-	float** travelerColor = new float*[numTravelers];
-
-	float hueStep = 360.f / numTravelers;
-
-	for (unsigned int k=0; k<numTravelers; k++)
-	{
-		travelerColor[k] = new float[4];
-
-		//	compute a hue for the door
-		float hue = k*hueStep;
-		//	convert the hue to an RGB color
-		int hueRegion = (int) (hue / 60);
-		switch (hueRegion)
-		{
-				//  hue in [0, 60] -- red-green, dominant red
-			case 0:
-				travelerColor[k][0] = 1.f;					//  red is max
-				travelerColor[k][1] = hue / 60.f;			//  green calculated
-				travelerColor[k][2] = 0.f;					//  blue is zero
-				break;
-
-				//  hue in [60, 120] -- red-green, dominant green
-			case 1:
-				travelerColor[k][0] = (120.f - hue) / 60.f;	//  red is calculated
-				travelerColor[k][1] = 1.f;					//  green max
-				travelerColor[k][2] = 0.f;					//  blue is zero
-				break;
-
-				//  hue in [120, 180] -- green-blue, dominant green
-			case 2:
-				travelerColor[k][0] = 0.f;					//  red is zero
-				travelerColor[k][1] = 1.f;					//  green max
-				travelerColor[k][2] = (hue - 120.f) / 60.f;	//  blue is calculated
-				break;
-
-				//  hue in [180, 240] -- green-blue, dominant blue
-			case 3:
-				travelerColor[k][0] = 0.f;					//  red is zero
-				travelerColor[k][1] = (240.f - hue) / 60;	//  green calculated
-				travelerColor[k][2] = 1.f;					//  blue is max
-				break;
-
-				//  hue in [240, 300] -- blue-red, dominant blue
-			case 4:
-				travelerColor[k][0] = (hue - 240.f) / 60;	//  red is calculated
-				travelerColor[k][1] = 0;						//  green is zero
-				travelerColor[k][2] = 1.f;					//  blue is max
-				break;
-
-				//  hue in [300, 360] -- blue-red, dominant red
-			case 5:
-				travelerColor[k][0] = 1.f;					//  red is max
-				travelerColor[k][1] = 0;						//  green is zero
-				travelerColor[k][2] = (360.f - hue) / 60;	//  blue is calculated
-				break;
-
-			default:
-				break;
-
-		}
-		travelerColor[k][3] = 1.f;					//  alpha --> full opacity
-	}
-
-	return travelerColor;
-}
@@ -40,17 +40,33 @@
 //	boxes and doors, so the two functions below will have to be called once for
 //	each pair robot/box and once for each door.
 
-//	This draws a colored multi-segment traveler
+//	This adds a colored multi-segment traveler to the frame's batch of
+//	travelers, which drawTravelerBatch then draws all at once
 void drawTraveler(const Traveler& traveler);
+void drawTravelerBatch(void);
+//	In the density view, a traveler is only drawn as its head
+void drawTravelerHead(unsigned int row, unsigned int col, const float rgba[4]);
+
+//	The rows and columns of the grid at least partly shown in the grid pane
+//	(which can be panned and zoomed)
+void getVisibleSquares(unsigned int& firstRow, unsigned int& lastRow,
+					   unsigned int& firstCol, unsigned int& lastCol);
+//	true when a pixel of the grid pane covers more than one square, and the
+//	grid is drawn as an image of the squares' density
+bool isDensityView(void);
 
 //	This function assigns a color to the door based on its number
 void drawDoor(int doorNumber, int doorRow, int doorCol);
 
-//	Defined in main.c
+//	Defined in main.cpp
 void speedupTravelers(void);
 void slowdownTravelers(void);
 void drawTravelers(void);
 void updateMessages(void);
+//	Defined in simulation.cpp
+SquareType getSquare(unsigned int row, unsigned int col);
+unsigned int getNumPartitions(void);
+SlidingPartition getPartition(unsigned int index);
 
 
 void drawGrid(void);
@@ -58,7 +74,6 @@ void drawMessages(int numMessages, char** message);
 void handleKeyboardEvent(unsigned char c, int x, int y);
 
 void initializeFrontEnd(int argc, char** argv);
-float** createTravelerColors(unsigned int numTravelers);
 
 #endif // GL_FRONT_END_H
 
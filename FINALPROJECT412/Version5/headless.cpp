@@ -0,0 +1,20 @@
+//
+//  headless.cpp
+//  Final Project CSC412
+//
+//	Entry point of traveler_headless, the build of the simulation that doesn't
+//	link against OpenGL/glut.  It always runs in --headless mode.
+
+#include <cstdlib>
+//
+#include "simulation.h"
+
+
+int main(int argc, char** argv)
+{
+	if (!parseArguments(argc, argv))
+		exit(1);
+
+	headlessMode = true;
+	return runHeadlessBenchmark();
+}
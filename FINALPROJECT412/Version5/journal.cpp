@@ -0,0 +1,175 @@
+//
+//  journal.cpp
+//  Final Project CSC412
+//
+//	Move journal (--journal=file).  Every move, growth, exit and partition
+//	shift is recorded as a fixed-size binary record, so that a run can be
+//	replayed (see replay.cpp) or checked afterwards.
+//
+//	Each event takes the next number of a global sequence while the thread
+//	making it holds the square it moves into and has not yet released the one
+//	it leaves.  A square thus changes hands in sequence order, and applying the
+//	records by increasing sequence number reproduces the run.  Records are
+//	buffered by each thread and written by blocks, so the file is only ordered
+//	within a block: readJournal puts the records back in sequence order.
+
+#include <vector>
+#include <string>
+#include <atomic>
+#include <algorithm>
+//
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+//
+#include "simulation.h"
+
+using namespace std;
+
+//-----------------------------------------------------------------------------
+//	Global variables
+//-----------------------------------------------------------------------------
+
+string journalPath;
+bool journalEnabled = false;
+
+const char JOURNAL_MAGIC[4] = {'T', 'R', 'V', 'J'};
+const uint32_t JOURNAL_VERSION = 1;
+//	Number of records a thread buffers before writing them
+const unsigned int JOURNAL_BLOCK_SIZE = 4096;
+
+FILE* journalFile = NULL;
+pthread_mutex_t journalLock;
+atomic<unsigned long long> journalSequence(0);
+thread_local vector<JournalRecord> journalBuffer;
+
+//-----------------------------------------------------------------------------
+//	Functions
+//-----------------------------------------------------------------------------
+
+//	FNV-1a hash of the grid's squares, row after row (the border is left out)
+unsigned long long gridChecksum(void)
+{
+	unsigned long long hash = 14695981039346656037ULL;
+	for (unsigned int i = 0; i < numRows; i++)
+		for (unsigned int j = 0; j < numCols; j++)
+			hash = (hash ^ getSquare(i, j)) * 1099511628211ULL;
+	return hash;
+}
+
+//	Creates the journal and writes its header.  Must be called once the grid
+//	is built and before the travelers start.
+void openJournal(const char* path)
+{
+	journalFile = fopen(path, "wb");
+	if (journalFile == NULL)
+	{
+		perror(path);
+		exit(1);
+	}
+	JournalHeader header;
+	memcpy(header.magic, JOURNAL_MAGIC, sizeof(header.magic));
+	header.version = JOURNAL_VERSION;
+	header.seed = randomSeed;
+	header.gridChecksum = gridChecksum();
+	header.numRows = numRows;
+	header.numCols = numCols;
+	header.numTravelers = numTravelers;
+	header.numMovesForGrowth = numMovesForGrowth;
+	fwrite(&header, sizeof(header), 1, journalFile);
+	pthread_mutex_init(&journalLock, NULL);
+	journalSequence.store(0);
+	journalEnabled = true;
+}
+
+//	Records an event in the calling thread's buffer
+void journalEvent(JournalEventType type, unsigned int id, unsigned long tick,
+				  unsigned int fromRow, unsigned int fromCol,
+				  unsigned int toRow, unsigned int toCol, Direction dir)
+{
+	JournalRecord record;
+	record.sequence = journalSequence.fetch_add(1, memory_order_relaxed);
+	record.id = id;
+	record.tick = static_cast<uint32_t>(tick);
+	record.from = fromRow * numCols + fromCol;
+	record.to = toRow * numCols + toCol;
+	record.type = static_cast<uint8_t>(type);
+	record.dir = static_cast<uint8_t>(dir);
+	memset(record.reserved, 0, sizeof(record.reserved));
+	journalBuffer.push_back(record);
+	if (journalBuffer.size() >= JOURNAL_BLOCK_SIZE)
+		flushJournal();
+}
+
+//	Writes the calling thread's buffered records.  A thread must flush its
+//	buffer before it terminates.
+void flushJournal(void)
+{
+	if (journalBuffer.empty())
+		return;
+	lockMutex(&journalLock, JOURNAL_LOCK);
+		fwrite(journalBuffer.data(), sizeof(JournalRecord), journalBuffer.size(), journalFile);
+	unlockMutex(&journalLock, JOURNAL_LOCK);
+	journalBuffer.clear();
+}
+
+//	Closes the journal, once all the travelers have terminated
+void closeJournal(void)
+{
+	if (!journalEnabled)
+		return;
+	journalEnabled = false;
+	fclose(journalFile);
+	journalFile = NULL;
+	pthread_mutex_destroy(&journalLock);
+}
+
+//	Reads a journal, with its records in sequence order.  Returns false, after
+//	printing why, if the file is not a complete journal.
+bool readJournal(const char* path, JournalHeader& header, vector<JournalRecord>& records)
+{
+	FILE* file = fopen(path, "rb");
+	if (file == NULL)
+	{
+		perror(path);
+		return false;
+	}
+	if (fread(&header, sizeof(header), 1, file) != 1 ||
+		memcmp(header.magic, JOURNAL_MAGIC, sizeof(header.magic)) != 0 ||
+		header.version != JOURNAL_VERSION)
+	{
+		fprintf(stderr, "%s is not a version %u journal\n", path, JOURNAL_VERSION);
+		fclose(file);
+		return false;
+	}
+	vector<JournalRecord> block(JOURNAL_BLOCK_SIZE);
+	records.clear();
+	size_t numRead;
+	while ((numRead = fread(block.data(), sizeof(JournalRecord), block.size(), file)) > 0)
+		records.insert(records.end(), block.begin(), block.begin() + numRead);
+	fclose(file);
+
+	//	The sequence numbers are 0 to n-1, so each record goes straight to its
+	//	place, no sort needed.  A journal whose run was interrupted misses the
+	//	records still buffered by the threads: only the part before the first
+	//	missing record can be replayed.  A record numbered n or more comes
+	//	after a missing one (or is corrupt), so it is never part of it.
+	size_t numRecords = records.size();
+	vector<JournalRecord> ordered(numRecords);
+	vector<bool> seen(numRecords, false);
+	for (size_t k = 0; k < records.size(); k++)
+		if (records[k].sequence < numRecords)
+		{
+			seen[records[k].sequence] = true;
+			ordered[records[k].sequence] = records[k];
+		}
+	size_t numComplete = find(seen.begin(), seen.end(), false) - seen.begin();
+	if (numComplete < numRecords)
+	{
+		fprintf(stderr, "%s: record %lu is missing, only the %lu records before it are used\n",
+				path, (unsigned long) numComplete, (unsigned long) numComplete);
+		ordered.resize(numComplete);
+	}
+	records.swap(ordered);
+	return true;
+}
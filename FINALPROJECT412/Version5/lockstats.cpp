@@ -0,0 +1,288 @@
+//
+//  lockstats.cpp
+//  Final Project CSC412
+//
+//	Lock statistics, compiled in with make LOCK_STATS=1 (-DLOCK_STATS).  Every
+//	lock taken through lockMutex/unlockMutex, and every partition flag tried,
+//	is counted per LockClass: acquisitions, acquisitions that had to wait,
+//	try-locks that gave up, time spent waiting and time the lock was held.
+//	The grid locks and the partition flags are also counted per square.
+//
+//	When the simulation ends, the counts are written to prefix.txt (per class,
+//	then per region of REGION_SIZE x REGION_SIZE squares, most waited on
+//	first) and prefix.pgm, a grayscale image of the grid where the brighter a
+//	square, the more often it was contended (log scale).  The prefix is given
+//	with --lock-stats=prefix.
+//
+//	Each thread counts in its own copy of the per-class statistics and adds it
+//	to the totals with flushLockStats, before it terminates.  The per-square
+//	counts are atomic, in a mapping of the size of the grid whose pages are
+//	only backed once a square in them is counted.
+
+#ifdef LOCK_STATS
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+//
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <ctime>
+#include <sys/mman.h>
+//
+#include "simulation.h"
+
+using namespace std;
+
+//-----------------------------------------------------------------------------
+//	Custom Data Types
+//-----------------------------------------------------------------------------
+struct ClassLockStats
+{
+	unsigned long long acquisitions;
+	unsigned long long contended;
+	unsigned long long failed;
+	unsigned long long waitNs;
+	unsigned long long holdNs;
+	unsigned long long maxWaitNs;
+	unsigned long long maxHoldNs;
+};
+
+struct SquareLockStats
+{
+	atomic<unsigned int> acquisitions;
+	atomic<unsigned int> contended;
+	atomic<unsigned long long> waitNs;
+	atomic<unsigned long long> holdNs;
+};
+
+//	One region of the per-region report
+struct RegionLockStats
+{
+	unsigned int row, col;
+	unsigned long long acquisitions, contended, waitNs, holdNs;
+};
+
+//-----------------------------------------------------------------------------
+//	Global variables
+//-----------------------------------------------------------------------------
+
+string lockStatsPath = "lock_stats";
+
+const char* LOCK_CLASS_NAME[NUM_LOCK_CLASSES] = {
+	"global", "grid", "partition_flag", "arena", "repair", "journal", "task", "inbox", "park"
+};
+//	Side of the regions of the per-region report, in squares
+const unsigned int REGION_SIZE = 32;
+//	Number of regions listed in the report
+const unsigned int MAX_REPORTED_REGIONS = 100;
+//	Largest side of the heatmap, in pixels: larger grids are scaled down
+const unsigned int MAX_HEATMAP_SIZE = 4096;
+
+pthread_mutex_t lockStatsLock = PTHREAD_MUTEX_INITIALIZER;
+ClassLockStats classStats[NUM_LOCK_CLASSES];
+SquareLockStats* squareStats = NULL;
+size_t squareStatsSize = 0;
+bool lockStatsDumped = false;
+
+thread_local ClassLockStats localStats[NUM_LOCK_CLASSES];
+//	When the calling thread acquired its lock of each class.  A thread never
+//	holds two locks of the same class.
+thread_local unsigned long long acquiredNs[NUM_LOCK_CLASSES];
+
+//-----------------------------------------------------------------------------
+//	Functions
+//-----------------------------------------------------------------------------
+
+inline unsigned long long nowNs(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+//	Called once the grid is built, before the travelers start.  The counts
+//	are also written at exit, for the GUI, which never frees the simulation.
+void initializeLockStats(void)
+{
+	for (unsigned int c = 0; c < NUM_LOCK_CLASSES; c++)
+		classStats[c] = ClassLockStats();
+	if (squareStats != NULL)
+		munmap(squareStats, squareStatsSize);
+	squareStatsSize = numRows * (size_t) numCols * sizeof(SquareLockStats);
+	void* stats = mmap(NULL, squareStatsSize, PROT_READ | PROT_WRITE,
+					   MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (stats == MAP_FAILED)
+	{
+		perror("Could not allocate the lock statistics");
+		exit(1);
+	}
+	squareStats = static_cast<SquareLockStats*>(stats);
+	lockStatsDumped = false;
+	static bool atExitSet = false;
+	if (!atExitSet)
+		atExitSet = atexit(dumpLockStats) == 0;
+}
+
+void recordLockAcquired(LockClass lockClass, unsigned int square, bool contended, unsigned long long waitNs)
+{
+	ClassLockStats& stats = localStats[lockClass];
+	stats.acquisitions++;
+	if (contended)
+	{
+		stats.contended++;
+		stats.waitNs += waitNs;
+		stats.maxWaitNs = max(stats.maxWaitNs, waitNs);
+	}
+	if (square != UINT_MAX && squareStats != NULL)
+	{
+		squareStats[square].acquisitions.fetch_add(1, memory_order_relaxed);
+		if (contended)
+		{
+			squareStats[square].contended.fetch_add(1, memory_order_relaxed);
+			squareStats[square].waitNs.fetch_add(waitNs, memory_order_relaxed);
+		}
+	}
+	acquiredNs[lockClass] = nowNs();
+}
+
+void recordLockReleased(LockClass lockClass, unsigned int square)
+{
+	unsigned long long holdNs = nowNs() - acquiredNs[lockClass];
+	ClassLockStats& stats = localStats[lockClass];
+	stats.holdNs += holdNs;
+	stats.maxHoldNs = max(stats.maxHoldNs, holdNs);
+	if (square != UINT_MAX && squareStats != NULL)
+		squareStats[square].holdNs.fetch_add(holdNs, memory_order_relaxed);
+}
+
+//	A try-lock that gave up counts as contended, without a wait
+void recordLockFailed(LockClass lockClass, unsigned int square)
+{
+	localStats[lockClass].failed++;
+	if (square != UINT_MAX && squareStats != NULL)
+		squareStats[square].contended.fetch_add(1, memory_order_relaxed);
+}
+
+//	Adds the calling thread's counts to the totals
+void flushLockStats(void)
+{
+	pthread_mutex_lock(&lockStatsLock);
+		for (unsigned int c = 0; c < NUM_LOCK_CLASSES; c++)
+		{
+			ClassLockStats& total = classStats[c];
+			const ClassLockStats& local = localStats[c];
+			total.acquisitions += local.acquisitions;
+			total.contended += local.contended;
+			total.failed += local.failed;
+			total.waitNs += local.waitNs;
+			total.holdNs += local.holdNs;
+			total.maxWaitNs = max(total.maxWaitNs, local.maxWaitNs);
+			total.maxHoldNs = max(total.maxHoldNs, local.maxHoldNs);
+			localStats[c] = ClassLockStats();
+		}
+	pthread_mutex_unlock(&lockStatsLock);
+}
+
+//	Writes the heatmap: one pixel per square, or per block of squares on a
+//	grid larger than MAX_HEATMAP_SIZE
+void writeLockHeatmap(const string& path)
+{
+	unsigned int scale = (max(numRows, numCols) + MAX_HEATMAP_SIZE - 1) / MAX_HEATMAP_SIZE;
+	unsigned int width = (numCols + scale - 1) / scale;
+	unsigned int height = (numRows + scale - 1) / scale;
+	vector<unsigned long long> counts(width * (size_t) height, 0);
+	for (unsigned int i = 0; i < numRows; i++)
+		for (unsigned int j = 0; j < numCols; j++)
+			counts[(i / scale) * (size_t) width + j / scale] +=
+				squareStats[i * (size_t) numCols + j].contended.load(memory_order_relaxed);
+	unsigned long long maxCount = *max_element(counts.begin(), counts.end());
+
+	FILE* file = fopen(path.c_str(), "wb");
+	if (file == NULL)
+	{
+		perror(path.c_str());
+		return;
+	}
+	fprintf(file, "P5\n# lock contention, log scale, %u x %u squares per pixel\n%u %u\n255\n",
+			scale, scale, width, height);
+	vector<unsigned char> row(width);
+	for (unsigned int i = 0; i < height; i++)
+	{
+		for (unsigned int j = 0; j < width; j++)
+			row[j] = maxCount == 0 ? 0 : static_cast<unsigned char>(
+						 lround(255 * log1p(counts[i * (size_t) width + j]) / log1p(maxCount)));
+		fwrite(row.data(), 1, width, file);
+	}
+	fclose(file);
+}
+
+void writeLockReport(const string& path)
+{
+	FILE* file = fopen(path.c_str(), "w");
+	if (file == NULL)
+	{
+		perror(path.c_str());
+		return;
+	}
+	fprintf(file, "# Lock statistics, times in microseconds\n");
+	fprintf(file, "%-16s %14s %12s %12s %14s %12s %14s %12s\n", "class", "acquisitions", "contended",
+			"gave_up", "wait", "max_wait", "hold", "max_hold");
+	for (unsigned int c = 0; c < NUM_LOCK_CLASSES; c++)
+	{
+		const ClassLockStats& stats = classStats[c];
+		fprintf(file, "%-16s %14llu %12llu %12llu %14.1f %12.1f %14.1f %12.1f\n", LOCK_CLASS_NAME[c],
+				stats.acquisitions, stats.contended, stats.failed, 1E-3 * stats.waitNs,
+				1E-3 * stats.maxWaitNs, 1E-3 * stats.holdNs, 1E-3 * stats.maxHoldNs);
+	}
+
+	//	The grid locks and partition flags, per region
+	unsigned int regionRows = (numRows + REGION_SIZE - 1) / REGION_SIZE;
+	unsigned int regionCols = (numCols + REGION_SIZE - 1) / REGION_SIZE;
+	vector<RegionLockStats> regions(regionRows * (size_t) regionCols, RegionLockStats());
+	for (unsigned int i = 0; i < numRows; i++)
+		for (unsigned int j = 0; j < numCols; j++)
+		{
+			const SquareLockStats& square = squareStats[i * (size_t) numCols + j];
+			RegionLockStats& region = regions[(i / REGION_SIZE) * (size_t) regionCols + j / REGION_SIZE];
+			region.row = i / REGION_SIZE * REGION_SIZE;
+			region.col = j / REGION_SIZE * REGION_SIZE;
+			region.acquisitions += square.acquisitions.load(memory_order_relaxed);
+			region.contended += square.contended.load(memory_order_relaxed);
+			region.waitNs += square.waitNs.load(memory_order_relaxed);
+			region.holdNs += square.holdNs.load(memory_order_relaxed);
+		}
+	sort(regions.begin(), regions.end(), [](const RegionLockStats& a, const RegionLockStats& b) {
+		return a.waitNs != b.waitNs ? a.waitNs > b.waitNs : a.contended > b.contended;
+	});
+	fprintf(file, "\n# Grid locks and partition flags per region of %u x %u squares, most waited on first\n",
+			REGION_SIZE, REGION_SIZE);
+	fprintf(file, "%8s %8s %14s %12s %14s %14s\n", "row", "col", "acquisitions", "contended", "wait", "hold");
+	for (unsigned int k = 0; k < regions.size() && k < MAX_REPORTED_REGIONS; k++)
+	{
+		const RegionLockStats& region = regions[k];
+		if (region.acquisitions == 0 && region.contended == 0)
+			break;
+		fprintf(file, "%8u %8u %14llu %12llu %14.1f %14.1f\n", region.row, region.col,
+				region.acquisitions, region.contended, 1E-3 * region.waitNs, 1E-3 * region.holdNs);
+	}
+	fclose(file);
+}
+
+//	Writes the report and the heatmap, once all the travelers have
+//	terminated.  The per-square counts stay mapped until the next run of the
+//	simulation, since at exit the travelers of the GUI may still be running.
+void dumpLockStats(void)
+{
+	if (squareStats == NULL || lockStatsDumped)
+		return;
+	lockStatsDumped = true;
+	flushLockStats();
+	writeLockReport(lockStatsPath + ".txt");
+	writeLockHeatmap(lockStatsPath + ".pgm");
+	fprintf(stderr, "Lock statistics written to %s.txt and %s.pgm\n", lockStatsPath.c_str(), lockStatsPath.c_str());
+}
+
+#endif	//	LOCK_STATS
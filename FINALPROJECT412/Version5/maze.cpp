@@ -0,0 +1,318 @@
+//
+//  maze.cpp
+//  Final Project CSC412
+//
+//	Maze files.  A maze built at startup (walls, partitions, exit and initial
+//	travelers) can be saved with --save-maze=file, and used again with
+//	--maze=file instead of generating one, so that runs can be compared on the
+//	same maze.  The file is mapped into memory privately and used as is, with
+//	no parsing: its grid section becomes the grid, and its partition index
+//	section the partition index.  Their pages are only read from the disk when
+//	first touched and only copied when first written to.  A huge maze thus
+//	loads in the time it takes to set up its travelers.  The partition index
+//	is mostly zeros, which are left as holes in the file.  --verify-maze
+//	also checks these two sections, reading them whole.
+//
+//	A checkpoint is the same file written during a run, while the travelers
+//	are paused, plus the travelers' move counters and random generators.
+//	Files are written next to their destination and renamed into place, so a
+//	checkpoint can replace the file the run was restored from, which is still
+//	mapped, and a failed write leaves the previous checkpoint intact.
+
+#include <vector>
+#include <string>
+#include <algorithm>
+//
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+//
+#include "simulation.h"
+
+using namespace std;
+
+//-----------------------------------------------------------------------------
+//	Global variables
+//-----------------------------------------------------------------------------
+
+string mazePath;
+string saveMazePath;
+bool verifyMaze = false;
+
+const char MAZE_MAGIC[4] = {'T', 'R', 'V', 'M'};
+const uint32_t MAZE_VERSION = 2;
+
+//	The mapping of the file given with --maze
+void* mazeMapping = NULL;
+size_t mazeMappingSize = 0;
+
+//-----------------------------------------------------------------------------
+//	Functions
+//-----------------------------------------------------------------------------
+
+//	Writes the current maze.  With withState, the travelers must be paused,
+//	and their state is saved too.  Returns false on error.
+bool saveMazeFile(const char* path, bool withState)
+{
+	size_t gridSize = (numRows + 2) * (size_t) gridStride;
+
+	//	The travelers' segments, head first
+	vector<uint32_t> lengths(travelers.count);
+	vector<MazeSegment> segments;
+	vector<TravelerSegment> body;
+	Traveler traveler;
+	for (unsigned int k = 0; k < travelers.count; k++)
+	{
+		lengths[k] = snapshotTraveler(k, traveler, body);
+		for (unsigned int i = 0; i < lengths[k]; i++)
+		{
+			const TravelerSegment& segment = segmentAt(traveler, i);
+			MazeSegment saved = {segment.row, segment.col, static_cast<uint32_t>(segment.dir)};
+			segments.push_back(saved);
+		}
+	}
+	//	The partitions, and the entries of the partition index they fill:
+	//	(square, partition index plus one)
+	vector<MazePartition> partitions(getNumPartitions());
+	vector<pair<uint64_t, uint16_t> > entries;
+	for (unsigned int k = 0; k < partitions.size(); k++)
+	{
+		SlidingPartition partition = getPartition(k);
+		partitions[k].isVertical = partition.isVertical;
+		partitions[k].startRow = partition.start.row;
+		partitions[k].startCol = partition.start.col;
+		partitions[k].length = partition.length;
+		for (unsigned int j = 0; j < partition.length; j++)
+		{
+			uint64_t row = partition.start.row + (partition.isVertical ? j : 0);
+			uint64_t col = partition.start.col + (partition.isVertical ? 0 : j);
+			entries.push_back(make_pair(row * numCols + col, static_cast<uint16_t>(k + 1)));
+		}
+	}
+	sort(entries.begin(), entries.end());
+
+	vector<MazeTravelerState> states;
+	for (unsigned int k = 0; withState && k < travelers.count; k++)
+	{
+		MazeTravelerState state;
+		memset(&state, 0, sizeof(state));
+		memcpy(state.random, travelers.random[k].s, sizeof(state.random));
+		state.totalMoves = travelers.totalMoves[k];
+		state.exitTime = travelers.exitTime[k];
+		state.moves = travelers.moves[k];
+		states.push_back(state);
+	}
+
+	MazeHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, MAZE_MAGIC, sizeof(header.magic));
+	header.version = MAZE_VERSION;
+	header.numRows = numRows;
+	header.numCols = numCols;
+	header.gridStride = gridStride;
+	header.exitRow = exitPos.row;
+	header.exitCol = exitPos.col;
+	header.numPartitions = partitions.size();
+	header.numTravelers = travelers.count;
+	header.numSegments = segments.size();
+	header.gridOffset = pageAligned(sizeof(header));
+	header.partitionIndexOffset = pageAligned(header.gridOffset + gridSize);
+	header.partitionOffset = pageAligned(header.partitionIndexOffset +
+										 numRows * (uint64_t) numCols * sizeof(uint16_t));
+	header.lengthOffset = header.partitionOffset + partitions.size() * sizeof(MazePartition);
+	header.segmentOffset = header.lengthOffset + lengths.size() * sizeof(uint32_t);
+	header.fileSize = header.segmentOffset + segments.size() * sizeof(MazeSegment);
+	if (withState)
+	{
+		header.stateOffset = (header.fileSize + sizeof(uint64_t) - 1) / sizeof(uint64_t) * sizeof(uint64_t);
+		header.fileSize = header.stateOffset + states.size() * sizeof(MazeTravelerState);
+		header.seed = randomSeed;
+		header.numMovesForGrowth = numMovesForGrowth;
+		header.numTravelersDone = numTravelersDone;
+		header.runTime = runTimeSeconds();
+	}
+
+	string tempPath = string(path) + ".tmp";
+	FILE* file = fopen(tempPath.c_str(), "wb");
+	if (file == NULL)
+	{
+		perror(tempPath.c_str());
+		return false;
+	}
+	bool written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+				   fseek(file, header.gridOffset, SEEK_SET) == 0 &&
+				   fwrite(grid, 1, gridSize, file) == gridSize;
+	//	Only the pages of the partition index with partitions on them are
+	//	written
+	const size_t PAGE_ENTRIES = sysconf(_SC_PAGESIZE) / sizeof(uint16_t);
+	vector<uint16_t> page(PAGE_ENTRIES);
+	for (size_t e = 0; e < entries.size() && written; )
+	{
+		uint64_t first = entries[e].first / PAGE_ENTRIES * PAGE_ENTRIES;
+		fill(page.begin(), page.end(), 0);
+		for ( ; e < entries.size() && entries[e].first < first + PAGE_ENTRIES; e++)
+			page[entries[e].first - first] = entries[e].second;
+		written = fseek(file, header.partitionIndexOffset + first * sizeof(uint16_t), SEEK_SET) == 0 &&
+				  fwrite(page.data(), sizeof(uint16_t), PAGE_ENTRIES, file) == PAGE_ENTRIES;
+	}
+	written = written && fseek(file, header.partitionOffset, SEEK_SET) == 0 &&
+				   fwrite(partitions.data(), sizeof(MazePartition), partitions.size(), file) == partitions.size() &&
+				   fwrite(lengths.data(), sizeof(uint32_t), lengths.size(), file) == lengths.size() &&
+				   fwrite(segments.data(), sizeof(MazeSegment), segments.size(), file) == segments.size() &&
+				   (!withState || fseek(file, header.stateOffset, SEEK_SET) == 0) &&
+				   fwrite(states.data(), sizeof(MazeTravelerState), states.size(), file) == states.size();
+	if (fclose(file) != 0 || !written || rename(tempPath.c_str(), path) != 0)
+	{
+		perror(path);
+		unlink(tempPath.c_str());
+		return false;
+	}
+	return true;
+}
+
+//	Checks that what a maze file holds is within its grid: the exit, the
+//	partitions, and the travelers' bodies, whose segments must follow one
+//	another.  Only the small sections are read.
+bool mazeContentsValid(const MazeFile& maze)
+{
+	const MazeHeader* header = maze.header;
+	const uint64_t rows = header->numRows, cols = header->numCols;
+	//	The partition index holds the index of a partition plus one
+	if (rows == 0 || cols == 0 || header->exitRow >= rows || header->exitCol >= cols ||
+		header->numPartitions > UINT16_MAX)
+		return false;
+
+	for (unsigned int k = 0; k < header->numPartitions; k++)
+	{
+		const MazePartition& partition = maze.partitions[k];
+		uint64_t lastRow = partition.startRow + (uint64_t) (partition.isVertical ? partition.length : 1);
+		uint64_t lastCol = partition.startCol + (uint64_t) (partition.isVertical ? 1 : partition.length);
+		if (partition.isVertical > 1 || partition.length == 0 || lastRow > rows || lastCol > cols)
+			return false;
+	}
+
+	uint64_t numSegments = 0;
+	for (unsigned int k = 0; k < header->numTravelers; k++)
+	{
+		uint32_t length = maze.lengths[k];
+		if (length > header->numSegments - numSegments)
+			return false;
+		const MazeSegment* body = maze.segments + numSegments;
+		for (uint32_t i = 0; i < length; i++)
+		{
+			if (body[i].row >= rows || body[i].col >= cols)
+				return false;
+			if (i > 0)
+			{
+				uint64_t rowDistance = max(body[i].row, body[i-1].row) - min(body[i].row, body[i-1].row);
+				uint64_t colDistance = max(body[i].col, body[i-1].col) - min(body[i].col, body[i-1].col);
+				if (rowDistance + colDistance != 1)
+					return false;
+			}
+		}
+		numSegments += length;
+	}
+	return true;
+}
+
+//	With --verify-maze: checks that the grid is surrounded by walls and holds
+//	square types only, and that the partition index names existing
+//	partitions.  This reads the grid and partition index sections once, in
+//	order, which takes seconds on a huge maze.  Without it, the border is
+//	trusted, and partitionAt ignores an index entry past the partition list.
+bool mazeSectionsValid(const MazeFile& maze)
+{
+	const MazeHeader* header = maze.header;
+	const uint64_t rows = header->numRows, cols = header->numCols;
+	for (uint64_t i = 0; i < rows + 2; i++)
+	{
+		const unsigned char* row = maze.grid + i * header->gridStride;
+		bool border = (i == 0 || i == rows + 1);
+		for (uint64_t j = 0; j < cols + 2; j++)
+			if (row[j] >= NUM_SQUARE_TYPES || ((border || j == 0 || j == cols + 1) && row[j] != WALL))
+				return false;
+	}
+	for (uint64_t k = 0; k < rows * cols; k++)
+		if (maze.partitionIndex[k] > header->numPartitions)
+			return false;
+	return true;
+}
+
+//	Maps a maze file into memory, and sets numRows, numCols and numTravelers
+//	from it.  Exits if the file is not a valid maze file.
+void mapMazeFile(const char* path, MazeFile& maze)
+{
+	int fd = open(path, O_RDONLY);
+	struct stat status;
+	if (fd < 0 || fstat(fd, &status) != 0)
+	{
+		perror(path);
+		exit(1);
+	}
+	mazeMappingSize = status.st_size;
+	mazeMapping = mazeMappingSize < sizeof(MazeHeader) ? MAP_FAILED :
+				  mmap(NULL, mazeMappingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (mazeMapping == MAP_FAILED)
+	{
+		fprintf(stderr, "%s is not a maze file\n", path);
+		exit(1);
+	}
+
+	char* base = static_cast<char*>(mazeMapping);
+	const MazeHeader* header = reinterpret_cast<const MazeHeader*>(base);
+	if (memcmp(header->magic, MAZE_MAGIC, sizeof(header->magic)) != 0 ||
+		header->version != MAZE_VERSION || header->fileSize != mazeMappingSize ||
+		header->gridStride < header->numCols + (uint64_t) 2 ||
+		header->numRows + (uint64_t) 2 > header->fileSize / header->gridStride ||
+		header->gridOffset > header->fileSize || header->partitionIndexOffset > header->fileSize ||
+		header->partitionOffset > header->fileSize || header->lengthOffset > header->fileSize ||
+		header->segmentOffset > header->fileSize || header->stateOffset > header->fileSize ||
+		header->gridOffset + (header->numRows + 2) * (uint64_t) header->gridStride > header->partitionIndexOffset ||
+		header->partitionIndexOffset + header->numRows * (uint64_t) header->numCols * sizeof(uint16_t) >
+			header->partitionOffset ||
+		header->partitionOffset + header->numPartitions * sizeof(MazePartition) > header->lengthOffset ||
+		header->lengthOffset + header->numTravelers * sizeof(uint32_t) > header->segmentOffset ||
+		header->segmentOffset + header->numSegments * sizeof(MazeSegment) > header->fileSize ||
+		(header->stateOffset != 0 &&
+		 (header->stateOffset < header->segmentOffset + header->numSegments * sizeof(MazeSegment) ||
+		  header->stateOffset + header->numTravelers * sizeof(MazeTravelerState) > header->fileSize)) ||
+		header->stateOffset % sizeof(uint64_t) != 0 ||
+		header->gridOffset % sysconf(_SC_PAGESIZE) != 0 ||
+		header->partitionIndexOffset % sysconf(_SC_PAGESIZE) != 0)
+	{
+		fprintf(stderr, "%s is not a version %u maze file\n", path, MAZE_VERSION);
+		exit(1);
+	}
+	maze.header = header;
+	maze.grid = reinterpret_cast<unsigned char*>(base + header->gridOffset);
+	maze.partitionIndex = reinterpret_cast<uint16_t*>(base + header->partitionIndexOffset);
+	maze.partitions = reinterpret_cast<const MazePartition*>(base + header->partitionOffset);
+	maze.lengths = reinterpret_cast<const uint32_t*>(base + header->lengthOffset);
+	maze.segments = reinterpret_cast<const MazeSegment*>(base + header->segmentOffset);
+	maze.states = header->stateOffset == 0 ? NULL :
+				  reinterpret_cast<const MazeTravelerState*>(base + header->stateOffset);
+	if (!mazeContentsValid(maze) || (verifyMaze && !mazeSectionsValid(maze)))
+	{
+		fprintf(stderr, "%s is not a version %u maze file\n", path, MAZE_VERSION);
+		exit(1);
+	}
+
+	numRows = header->numRows;
+	numCols = header->numCols;
+	numTravelers = header->numTravelers;
+}
+
+//	Unmaps the maze file, and with it the grid and the partition index
+void unmapMazeFile(void)
+{
+	if (mazeMapping == NULL)
+		return;
+	munmap(mazeMapping, mazeMappingSize);
+	mazeMapping = NULL;
+	mazeMappingSize = 0;
+}
@@ -0,0 +1,248 @@
+//
+//  navigation.cpp
+//  Final Project CSC412
+//
+//	Flow-field navigation (--nav=flow).  A breadth-first search from the exit
+//	gives every square its distance to the exit, walking around walls and
+//	partitions.  The distance field is computed before the travelers are
+//	launched and is shared by all of them: a traveler prefers to step onto a
+//	neighbor closer to the exit than its head.
+//
+//	When a partition slides, one square gets blocked and one gets freed.
+//	Rather than running the search again over the whole grid, only the
+//	squares whose distance changes are updated: a freed square starts a wave
+//	of decreasing distances, and a blocked square invalidates the squares that
+//	were only reached through it, which are then given new distances from the
+//	edge of that region.  Repairs are serialized by a lock.  Travelers read the
+//	field without locking, so they may briefly follow a stale distance.
+
+#include <vector>
+#include <atomic>
+#include <algorithm>
+//
+#include <climits>
+//
+#include "simulation.h"
+
+using namespace std;
+
+//-----------------------------------------------------------------------------
+//	Global variables
+//-----------------------------------------------------------------------------
+
+NavigationMode navigationMode = RANDOM_NAVIGATION;
+
+//	Distance to the exit of each square, in moves, laid out like the grid.
+//	Walls (including the border) and partitions are BLOCKED, the squares they
+//	cut off from the exit UNREACHABLE.
+const unsigned int BLOCKED = UINT_MAX;
+const unsigned int UNREACHABLE = UINT_MAX - 1;
+atomic<unsigned int> * exitDistance = NULL;
+
+//	Only one repair at a time
+pthread_mutex_t repairLock;
+
+//-----------------------------------------------------------------------------
+//	Functions
+//-----------------------------------------------------------------------------
+
+//	Squares a traveler can never walk through
+inline bool isObstacle(SquareType type)
+{
+	return type == WALL || type == VERTICAL_PARTITION || type == HORIZONTAL_PARTITION;
+}
+
+inline unsigned int distanceAt(unsigned int square)
+{
+	return exitDistance[square].load(memory_order_relaxed);
+}
+
+inline void setDistance(unsigned int square, unsigned int distance)
+{
+	exitDistance[square].store(distance, memory_order_relaxed);
+}
+
+//	Gets the squares next to a square.  Returns their number.  A square of the
+//	grid always has four of them, the squares of the border being BLOCKED.
+unsigned int neighborsOf(unsigned int square, unsigned int* neighbors)
+{
+	for (unsigned int d = 0; d < NUM_DIRECTIONS; d++)
+		neighbors[d] = neighborIndex(square, static_cast<Direction>(d));
+	return NUM_DIRECTIONS;
+}
+
+inline SquareType squareType(unsigned int square)
+{
+	return static_cast<SquareType>(grid[square].load(memory_order_relaxed));
+}
+
+//	Best distance a square can get from its neighbors (UNREACHABLE if none
+//	of them leads to the exit)
+unsigned int distanceFromNeighbors(unsigned int square)
+{
+	unsigned int neighbors[NUM_DIRECTIONS];
+	unsigned int numNeighbors = neighborsOf(square, neighbors);
+	unsigned int best = UNREACHABLE;
+	for (unsigned int k = 0; k < numNeighbors; k++)
+		if (distanceAt(neighbors[k]) < best - 1)
+			best = distanceAt(neighbors[k]) + 1;
+	return best;
+}
+
+//	Lowers the distances of the squares around the given ones, which must be
+//	sorted by increasing distance.  Unit moves make this a breadth-first search
+//	with several sources at different distances: at each step, the closest of
+//	the next source and the front of the queue is expanded.
+void propagateDistances(const vector<pair<unsigned int, unsigned int> >& sources)
+{
+	vector<pair<unsigned int, unsigned int> > queue;
+	size_t nextSource = 0, front = 0;
+	while (nextSource < sources.size() || front < queue.size())
+	{
+		pair<unsigned int, unsigned int> current;
+		if (front == queue.size() ||
+			(nextSource < sources.size() && sources[nextSource].first <= queue[front].first))
+			current = sources[nextSource++];
+		else
+			current = queue[front++];
+		//	Already lowered since it was queued
+		if (distanceAt(current.second) != current.first)
+			continue;
+		unsigned int neighbors[NUM_DIRECTIONS];
+		unsigned int numNeighbors = neighborsOf(current.second, neighbors);
+		for (unsigned int k = 0; k < numNeighbors; k++)
+		{
+			unsigned int distance = distanceAt(neighbors[k]);
+			if (distance != BLOCKED && distance > current.first + 1)
+			{
+				setDistance(neighbors[k], current.first + 1);
+				queue.push_back(make_pair(current.first + 1, neighbors[k]));
+			}
+		}
+	}
+}
+
+//	Computes the distance field, by breadth-first search from the exit.
+//	Travelers are not obstacles: they move out of the way.
+void computeExitDistances(void)
+{
+	unsigned int numSquares = (numRows + 2) * gridStride;
+	exitDistance = new atomic<unsigned int>[numSquares];
+	for (unsigned int i = 0; i < numSquares; i++)
+		setDistance(i, isObstacle(squareType(i)) ? BLOCKED : UNREACHABLE);
+	pthread_mutex_init(&repairLock, NULL);
+
+	unsigned int exitSquare = squareIndex(exitPos.row, exitPos.col);
+	setDistance(exitSquare, 0);
+	propagateDistances(vector<pair<unsigned int, unsigned int> >(1, make_pair(0U, exitSquare)));
+}
+
+void freeExitDistances(void)
+{
+	if (exitDistance == NULL)
+		return;
+	pthread_mutex_destroy(&repairLock);
+	delete []exitDistance;
+	exitDistance = NULL;
+}
+
+//	Removes a square that just got blocked from the distance field.  The
+//	squares whose distance only held through it lose their distance, layer by
+//	layer away from it: a square keeps its distance if some neighbor is still
+//	one move closer to the exit.  The invalidated region then gets new
+//	distances from its edge inward.
+void blockSquare(unsigned int blocked)
+{
+	unsigned int blockedDistance = distanceAt(blocked);
+	setDistance(blocked, BLOCKED);
+	if (blockedDistance == UNREACHABLE)
+		return;
+	vector<unsigned int> invalidated;
+	//	Squares with their distance before the repair, in increasing order,
+	//	so that a layer is settled before the next one is checked
+	vector<pair<unsigned int, unsigned int> > queue(1, make_pair(blockedDistance, blocked));
+	for (size_t k = 0; k < queue.size(); k++)
+	{
+		unsigned int distance = queue[k].first;
+		unsigned int neighbors[NUM_DIRECTIONS];
+		unsigned int numNeighbors = neighborsOf(queue[k].second, neighbors);
+		for (unsigned int j = 0; j < numNeighbors; j++)
+		{
+			if (distanceAt(neighbors[j]) != distance + 1)
+				continue;
+			unsigned int others[NUM_DIRECTIONS];
+			unsigned int numOthers = neighborsOf(neighbors[j], others);
+			bool supported = false;
+			for (unsigned int i = 0; i < numOthers && !supported; i++)
+				supported = distanceAt(others[i]) == distance;
+			if (!supported)
+			{
+				setDistance(neighbors[j], UNREACHABLE);
+				invalidated.push_back(neighbors[j]);
+				queue.push_back(make_pair(distance + 1, neighbors[j]));
+			}
+		}
+	}
+
+	vector<pair<unsigned int, unsigned int> > sources;
+	for (size_t k = 0; k < invalidated.size(); k++)
+	{
+		unsigned int distance = distanceFromNeighbors(invalidated[k]);
+		if (distance != UNREACHABLE)
+		{
+			setDistance(invalidated[k], distance);
+			sources.push_back(make_pair(distance, invalidated[k]));
+		}
+	}
+	sort(sources.begin(), sources.end());
+	propagateDistances(sources);
+}
+
+//	Adds a square that just got freed to the distance field.  It may open a
+//	shorter way to the exit for the squares behind it.
+void freeSquare(unsigned int freed)
+{
+	setDistance(freed, distanceFromNeighbors(freed));
+	if (distanceAt(freed) != UNREACHABLE)
+		propagateDistances(vector<pair<unsigned int, unsigned int> >(1, make_pair(distanceAt(freed), freed)));
+}
+
+//	Updates the distance field after a partition slid from square
+//	(freedRow, freedCol) to square (blockedRow, blockedCol).  Two partitions
+//	can pass the same square to each other, and their repairs may not come in
+//	the order of their moves, so each square is set to what the grid holds now
+//	rather than to what the move did.  The last repair to look at a square
+//	always comes after its last change.
+void repairExitDistances(unsigned int blockedRow, unsigned int blockedCol,
+						 unsigned int freedRow, unsigned int freedCol)
+{
+	unsigned int squares[2] = {squareIndex(blockedRow, blockedCol), squareIndex(freedRow, freedCol)};
+	lockMutex(&repairLock, REPAIR_LOCK);
+		for (unsigned int k = 0; k < 2; k++)
+			if (isObstacle(squareType(squares[k])) && distanceAt(squares[k]) != BLOCKED)
+				blockSquare(squares[k]);
+		for (unsigned int k = 0; k < 2; k++)
+			if (!isObstacle(squareType(squares[k])) && distanceAt(squares[k]) == BLOCKED)
+				freeSquare(squares[k]);
+	unlockMutex(&repairLock, REPAIR_LOCK);
+}
+
+//	Lists the directions other than forbiddenDir that lead from (row, col) to
+//	a square closer to the exit, in random order when there are two of them.
+//	Returns the number of directions written to choices.
+unsigned int flowDirections(unsigned int row, unsigned int col, Direction forbiddenDir,
+							Direction* choices, RandomState& random)
+{
+	unsigned int square = squareIndex(row, col);
+	unsigned int here = distanceAt(square);
+	unsigned int numChoices = 0;
+	for (unsigned int d = 0; d < NUM_DIRECTIONS; d++)
+	{
+		if (d != forbiddenDir && distanceAt(neighborIndex(square, static_cast<Direction>(d))) < here)
+			choices[numChoices++] = static_cast<Direction>(d);
+	}
+	//	Break ties at random, so that travelers don't all hug the same wall
+	if (numChoices == 2 && randomBelow(random, 2))
+		swap(choices[0], choices[1]);
+	return numChoices;
+}
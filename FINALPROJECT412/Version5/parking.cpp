@@ -0,0 +1,191 @@
+//
+//  parking.cpp
+//  Final Project CSC412
+//
+//	Parking lot for the traveler threads (--scheduler=threads).  A traveler
+//	boxed in by other travelers sleeps until one of the squares next to its
+//	head is released, instead of polling the grid.  The waiters are kept in
+//	buckets keyed by square; releaseSquare wakes those of the square it frees.
+//	A parked thread sleeps on a futex of its own, so it is woken by the first
+//	of its squares to be freed, whichever bucket it is in.
+//
+//	A wakeup cannot be lost: the waiter registers, then reads its squares
+//	again, while the releaser writes the square, then looks for waiters.  With
+//	a full fence on both sides, either the waiter sees the square free and
+//	doesn't sleep, or the releaser sees the waiter and wakes it.  A parked
+//	thread also wakes up after MAX_PARK_TIME, and when the travelers are asked
+//	to pause or stop.  A traveler walled in (no traveler around its head) can
+//	never move again, since walls never move: it stays parked, with no
+//	timeout, until the travelers are asked to pause or stop.
+
+#include <vector>
+#include <atomic>
+//
+#include <cstdlib>
+#include <ctime>
+#include <climits>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+//
+#include "simulation.h"
+
+using namespace std;
+
+//-----------------------------------------------------------------------------
+//	Custom Data Type
+//-----------------------------------------------------------------------------
+struct alignas(64) ParkingBucket
+{
+	/**	Protects waiters
+	 */
+	pthread_mutex_t lock;
+
+	/**	Number of entries in waiters, read by releasers without locking
+	 */
+	atomic<unsigned int> numWaiters;
+
+	/**	(square, traveler) pairs
+	 */
+	vector<pair<unsigned int, unsigned int> > waiters;
+};
+
+//-----------------------------------------------------------------------------
+//	Global variables
+//-----------------------------------------------------------------------------
+
+bool parkingEnabled = false;
+atomic<unsigned int> numParked(0);
+
+//	Number of buckets (a power of 2)
+const unsigned int NUM_PARKING_BUCKETS = 4096;
+//	Longest time a traveler stays parked without being woken (in nanoseconds)
+const long MAX_PARK_TIME = 100000000L;
+
+ParkingBucket* parkingBuckets = NULL;
+//	One futex per traveler: 1 while it is parked
+atomic<int>* parkWord = NULL;
+
+//-----------------------------------------------------------------------------
+//	Functions
+//-----------------------------------------------------------------------------
+
+inline ParkingBucket& bucketOf(unsigned int square)
+{
+	return parkingBuckets[(square * 2654435761U) >> 20 & (NUM_PARKING_BUCKETS - 1)];
+}
+
+inline void futexWait(atomic<int>* word, int value, const struct timespec* timeout)
+{
+	syscall(SYS_futex, reinterpret_cast<int*>(word), FUTEX_WAIT_PRIVATE, value, timeout, NULL, 0);
+}
+
+inline void futexWake(atomic<int>* word)
+{
+	syscall(SYS_futex, reinterpret_cast<int*>(word), FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+}
+
+//	Wakes a parked traveler, if it is still parked
+inline void unparkTraveler(unsigned int index)
+{
+	if (parkWord[index].exchange(0, memory_order_acq_rel) == 1)
+		futexWake(&parkWord[index]);
+}
+
+void initializeParking(void)
+{
+	parkingBuckets = new ParkingBucket[NUM_PARKING_BUCKETS];
+	for (unsigned int b = 0; b < NUM_PARKING_BUCKETS; b++)
+	{
+		pthread_mutex_init(&parkingBuckets[b].lock, NULL);
+		parkingBuckets[b].numWaiters.store(0, memory_order_relaxed);
+	}
+	parkWord = new atomic<int>[numTravelers];
+	for (unsigned int k = 0; k < numTravelers; k++)
+		parkWord[k].store(0, memory_order_relaxed);
+	numParked = 0;
+	parkingEnabled = true;
+}
+
+//	Once all travelers have terminated
+void freeParking(void)
+{
+	if (!parkingEnabled)
+		return;
+	parkingEnabled = false;
+	for (unsigned int b = 0; b < NUM_PARKING_BUCKETS; b++)
+		pthread_mutex_destroy(&parkingBuckets[b].lock);
+	delete []parkingBuckets;
+	delete []parkWord;
+	parkingBuckets = NULL;
+	parkWord = NULL;
+}
+
+//	Parks traveler index until one of the squares (grid indices) stops
+//	holding a traveler, or MAX_PARK_TIME has passed.  With no square, until
+//	it is woken by unparkAllTravelers.
+void parkTraveler(unsigned int index, const unsigned int* squares, unsigned int numSquares)
+{
+	parkWord[index].store(1, memory_order_relaxed);
+	for (unsigned int k = 0; k < numSquares; k++)
+	{
+		ParkingBucket& bucket = bucketOf(squares[k]);
+		lockMutex(&bucket.lock, PARK_LOCK);
+			bucket.waiters.push_back(make_pair(squares[k], index));
+			bucket.numWaiters.fetch_add(1, memory_order_relaxed);
+		unlockMutex(&bucket.lock, PARK_LOCK);
+	}
+	numParked.fetch_add(1, memory_order_seq_cst);
+	atomic_thread_fence(memory_order_seq_cst);
+
+	bool wait = !stopRequested.load(memory_order_relaxed) && !pauseRequested.load(memory_order_relaxed);
+	for (unsigned int k = 0; k < numSquares && wait; k++)
+		wait = grid[squares[k]].load(memory_order_relaxed) == TRAVELER;
+	if (wait)
+	{
+		struct timespec timeout = {0, MAX_PARK_TIME};
+		futexWait(&parkWord[index], 1, numSquares > 0 ? &timeout : NULL);
+	}
+	parkWord[index].store(0, memory_order_relaxed);
+	numParked.fetch_sub(1, memory_order_relaxed);
+
+	for (unsigned int k = 0; k < numSquares; k++)
+	{
+		ParkingBucket& bucket = bucketOf(squares[k]);
+		lockMutex(&bucket.lock, PARK_LOCK);
+			for (unsigned int i = 0; i < bucket.waiters.size(); i++)
+				if (bucket.waiters[i] == make_pair(squares[k], index))
+				{
+					bucket.waiters[i] = bucket.waiters.back();
+					bucket.waiters.pop_back();
+					break;
+				}
+			bucket.numWaiters.fetch_sub(1, memory_order_relaxed);
+		unlockMutex(&bucket.lock, PARK_LOCK);
+	}
+}
+
+//	Wakes the travelers parked on a square that was just released.  Called
+//	through notifySquareFreed, once some traveler is parked.
+void unparkSquare(unsigned int square)
+{
+	ParkingBucket& bucket = bucketOf(square);
+	if (bucket.numWaiters.load(memory_order_relaxed) == 0)
+		return;
+	lockMutex(&bucket.lock, PARK_LOCK);
+		for (unsigned int i = 0; i < bucket.waiters.size(); i++)
+			if (bucket.waiters[i].first == square)
+				unparkTraveler(bucket.waiters[i].second);
+	unlockMutex(&bucket.lock, PARK_LOCK);
+}
+
+//	Wakes all parked travelers, after pauseRequested or stopRequested was set
+void unparkAllTravelers(void)
+{
+	if (!parkingEnabled)
+		return;
+	atomic_thread_fence(memory_order_seq_cst);
+	for (unsigned int k = 0; k < numTravelers; k++)
+		if (parkWord[k].load(memory_order_relaxed) == 1)
+			unparkTraveler(k);
+}
@@ -0,0 +1,131 @@
+//
+//  replay.cpp
+//  Final Project CSC412
+//
+//	Entry point of traveler_replay, which plays back a move journal recorded
+//	with --journal=file.  The maze is rebuilt from the journal's seed (or read
+//	from the maze file the run used, given with --maze=file, or from the
+//	checkpoint it was restored from, given with --restore=file), then the
+//	records are applied to the grid, the partitions and the travelers in
+//	sequence order, as fast as possible: no threads, no locks, no sleeping.
+//	Prints statistics as JSON on stdout, like the headless benchmark.
+//
+//	Usage: traveler_replay journal [--maze=file | --restore=file] [--verify-maze] [--repeat=N]
+
+#include <vector>
+//
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+//
+#include "simulation.h"
+
+using namespace std;
+
+
+int main(int argc, char** argv)
+{
+	const char* path = NULL;
+	unsigned int numRepeats = 1;
+	bool argsOK = true;
+	for (int k = 1; k < argc; k++)
+	{
+		if (strncmp(argv[k], "--repeat=", 9) == 0)
+			numRepeats = atoi(argv[k] + 9);
+		else if (strcmp(argv[k], "--verify-maze") == 0)
+			verifyMaze = true;
+		else if (strncmp(argv[k], "--maze=", 7) == 0)
+			mazePath = argv[k] + 7;
+		else if (strncmp(argv[k], "--restore=", 10) == 0)
+		{
+			mazePath = argv[k] + 10;
+			restoreState = true;
+		}
+		else if (path == NULL && strncmp(argv[k], "--", 2) != 0)
+			path = argv[k];
+		else
+			argsOK = false;
+	}
+	if (!argsOK || path == NULL || numRepeats == 0)
+	{
+		fprintf(stderr, "Usage: %s journal [--maze=file | --restore=file] [--verify-maze] [--repeat=N]\n", argv[0]);
+		exit(1);
+	}
+
+	JournalHeader header;
+	vector<JournalRecord> records;
+	if (!readJournal(path, header, records))
+		exit(1);
+
+	//	The same maze as the recorded run.  No square is ever claimed by two
+	//	threads, so the grid needs no locks.
+	numRows = header.numRows;
+	numCols = header.numCols;
+	numTravelers = header.numTravelers;
+	numMovesForGrowth = header.numMovesForGrowth;
+	randomSeed = header.seed;
+	seedGiven = true;
+	headlessMode = true;
+	occupancyEngine = ATOMIC_ENGINE;
+
+	unsigned long long eventCount[NUM_JOURNAL_EVENTS] = {0};
+	for (size_t k = 0; k < records.size(); k++)
+		if (records[k].type < NUM_JOURNAL_EVENTS)
+			eventCount[records[k].type]++;
+
+	//	Only the playback itself is timed, not the rebuilding of the maze
+	double replayTime = 0.0;
+	size_t numApplied = 0;
+	unsigned int travelersExited = 0;
+	unsigned long long finalChecksum = 0;
+	for (unsigned int r = 0; r < numRepeats; r++)
+	{
+		initializeSimulation();
+		if (gridChecksum() != header.gridChecksum)
+		{
+			fprintf(stderr, "%s: the maze rebuilt from seed %llu differs from the recorded one\n",
+					path, (unsigned long long) header.seed);
+			if (mazePath.empty())
+				fprintf(stderr, "If the run used a maze file, give it with --maze=file or --restore=file\n");
+			exit(1);
+		}
+		struct timespec start, end;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for (numApplied = 0; numApplied < records.size(); numApplied++)
+			if (!applyJournalRecord(records[numApplied]))
+				break;
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		replayTime += (end.tv_sec - start.tv_sec) + 1E-9 * (end.tv_nsec - start.tv_nsec);
+
+		travelersExited = 0;
+		for (unsigned int k = 0; k < travelers.count; k++)
+			if (travelers.length[k] == 0)
+				travelersExited++;
+		finalChecksum = gridChecksum();
+		freeApplication();
+	}
+
+	printf("{\n");
+	printf("  \"journal\": \"%s\",\n", path);
+	printf("  \"seed\": %llu,\n", (unsigned long long) header.seed);
+	printf("  \"rows\": %u,\n", header.numRows);
+	printf("  \"cols\": %u,\n", header.numCols);
+	printf("  \"travelers\": %u,\n", header.numTravelers);
+	printf("  \"moves_for_growth\": %u,\n", header.numMovesForGrowth);
+	printf("  \"records\": %lu,\n", (unsigned long) records.size());
+	printf("  \"moves\": %llu,\n", eventCount[JOURNAL_MOVE]);
+	printf("  \"growths\": %llu,\n", eventCount[JOURNAL_GROWTH]);
+	printf("  \"exits\": %llu,\n", eventCount[JOURNAL_EXIT]);
+	printf("  \"shifts\": %llu,\n", eventCount[JOURNAL_SHIFT]);
+	if (numApplied < records.size())
+		printf("  \"first_bad_record\": %lu,\n", (unsigned long) numApplied);
+	printf("  \"travelers_exited\": %u,\n", travelersExited);
+	printf("  \"final_grid_checksum\": %llu,\n", finalChecksum);
+	printf("  \"repeats\": %u,\n", numRepeats);
+	printf("  \"replay_s\": %.6f,\n", replayTime / numRepeats);
+	printf("  \"records_per_sec\": %.1f\n", replayTime > 0 ? numRepeats * numApplied / replayTime : 0.0);
+	printf("}\n");
+
+	return numApplied == records.size() ? 0 : 1;
+}
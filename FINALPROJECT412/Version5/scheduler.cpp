@@ -0,0 +1,208 @@
+//
+//  scheduler.cpp
+//  Final Project CSC412
+//
+//	M:N scheduling of the travelers (--scheduler=pool).  Instead of one thread
+//	per traveler, a fixed pool of worker threads (one per core by default) runs
+//	the travelers as lightweight tasks, each task making one move attempt per
+//	tick.
+//
+//	Each worker owns a deque of tasks.  During a tick, a worker runs the tasks
+//	of its own deque first, then steals from the back of the other workers'
+//	deques, so that a worker whose travelers have all exited keeps busy.  A task
+//	that is still live goes back to the worker that ran it, for the next tick.
+//	Ticks are separated by travelerSleepTime, or more while no traveler moves,
+//	so that a jam doesn't keep the workers busy.  The pool pauses for
+//	checkpoints between ticks.
+
+#include <vector>
+#include <deque>
+//
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+#include <sched.h>
+//
+#include "simulation.h"
+
+using namespace std;
+
+//-----------------------------------------------------------------------------
+//	Custom Data Type
+//-----------------------------------------------------------------------------
+struct Worker
+{
+	/**	Index of the worker in the pool
+	 */
+	unsigned int index;
+
+	/**	The worker thread
+	 */
+	pthread_t thread;
+
+	/**	Protects tasks, which other workers can steal from
+	 */
+	pthread_mutex_t lock;
+
+	/**	This tick's tasks (traveler indices)
+	 */
+	deque<unsigned int> tasks;
+
+	/**	Next tick's tasks.  Only touched by the worker itself.
+	 */
+	vector<unsigned int> next;
+};
+
+//---------------------------------------------------------------------------
+//  File-level global variables
+//---------------------------------------------------------------------------
+vector<Worker> workerList;
+//	Tasks of the current tick that haven't been run yet
+atomic<unsigned int> tickTasksLeft(0);
+//	Set when a traveler moves during the current tick
+atomic<bool> tickMoved(false);
+//	Backoff between ticks, only touched by the worker that sleeps
+unsigned int tickWaitTime = 0;
+//	Number of tasks of the current tick, set by one worker between ticks
+unsigned int tickTaskCount = 0;
+pthread_barrier_t tickBarrier;
+
+//---------------------------------------------------------------------------
+//  Private functions' prototypes
+//---------------------------------------------------------------------------
+void* workerFunc(void* arg);
+bool popTask(Worker& worker, unsigned int& task);
+bool stealTask(unsigned int thief, unsigned int& task);
+
+
+void startWorkerPool(void)
+{
+	unsigned int numPoolWorkers = numWorkers;
+	if (numPoolWorkers == 0)
+		numPoolWorkers = sysconf(_SC_NPROCESSORS_ONLN);
+	if (numPoolWorkers > numLiveThreads)
+		numPoolWorkers = numLiveThreads;
+	if (numPoolWorkers == 0)
+		return;
+
+	workerList.resize(numPoolWorkers);
+	pthread_barrier_init(&tickBarrier, NULL, numPoolWorkers);
+	for (unsigned int w=0; w<numPoolWorkers; w++)
+	{
+		workerList[w].index = w;
+		pthread_mutex_init(&workerList[w].lock, NULL);
+	}
+	//	Deal the live travelers to the workers
+	unsigned int numTasks = 0;
+	for (unsigned int k=0; k<numTravelers; k++)
+		if (travelers.length[k] > 0)
+			workerList[numTasks++ % numPoolWorkers].tasks.push_back(k);
+	tickTasksLeft = numTasks;
+	tickTaskCount = numTasks;
+	tickMoved = false;
+	tickWaitTime = 0;
+	//	The pool is a single runner: the worker that pauses between ticks
+	addRunners(1);
+
+	for (unsigned int w=0; w<numPoolWorkers; w++)
+		pthread_create(&workerList[w].thread, NULL, workerFunc, &workerList[w]);
+}
+
+//	Waits for the workers to terminate, which they do once all travelers
+//	have left the simulation
+void joinWorkerPool(void)
+{
+	for (unsigned int w=0; w<workerList.size(); w++)
+	{
+		pthread_join(workerList[w].thread, NULL);
+		pthread_mutex_destroy(&workerList[w].lock);
+	}
+	if (!workerList.empty())
+		pthread_barrier_destroy(&tickBarrier);
+	workerList.clear();
+}
+
+void* workerFunc(void* arg)
+{
+	Worker& worker = *(Worker*) arg;
+	while (tickTaskCount > 0)
+	{
+		//	Run this tick's tasks, our own first, then stolen ones
+		bool moved = false;
+		while (tickTasksLeft.load(memory_order_acquire) > 0)
+		{
+			unsigned int task;
+			if (popTask(worker, task) || stealTask(worker.index, task))
+			{
+				if (travelerStep(task, moved))
+					worker.next.push_back(task);
+				tickTasksLeft.fetch_sub(1, memory_order_acq_rel);
+			}
+			//	The last tasks of the tick are running on other workers
+			else
+				sched_yield();
+		}
+		if (moved)
+			tickMoved.store(true, memory_order_relaxed);
+		pthread_barrier_wait(&tickBarrier);
+
+		//	Queue up the live tasks for the next tick
+		lockMutex(&worker.lock, TASK_LOCK);
+			worker.tasks.assign(worker.next.begin(), worker.next.end());
+		unlockMutex(&worker.lock, TASK_LOCK);
+		tickTasksLeft.fetch_add(worker.next.size(), memory_order_acq_rel);
+		worker.next.clear();
+
+		//	One worker sleeps between ticks and takes the task count, which
+		//	no worker reads until all are past the last barrier
+		if (pthread_barrier_wait(&tickBarrier) == PTHREAD_BARRIER_SERIAL_THREAD)
+		{
+			checkPause();
+			sleepBetweenTicks(tickMoved.exchange(false, memory_order_relaxed), tickWaitTime);
+			tickTaskCount = tickTasksLeft.load(memory_order_acquire);
+		}
+		pthread_barrier_wait(&tickBarrier);
+	}
+	if (journalEnabled)
+		flushJournal();
+	flushLockStats();
+	if (worker.index == 0)
+		removeRunner();
+	return NULL;
+}
+
+//	Takes a task from the front of the worker's own deque
+bool popTask(Worker& worker, unsigned int& task)
+{
+	bool found = false;
+	lockMutex(&worker.lock, TASK_LOCK);
+		if (!worker.tasks.empty())
+		{
+			task = worker.tasks.front();
+			worker.tasks.pop_front();
+			found = true;
+		}
+	unlockMutex(&worker.lock, TASK_LOCK);
+	return found;
+}
+
+//	Takes a task from the back of another worker's deque
+bool stealTask(unsigned int thief, unsigned int& task)
+{
+	for (unsigned int k=1; k<workerList.size(); k++)
+	{
+		Worker& victim = workerList[(thief + k) % workerList.size()];
+		bool found = false;
+		lockMutex(&victim.lock, TASK_LOCK);
+			if (!victim.tasks.empty())
+			{
+				task = victim.tasks.back();
+				victim.tasks.pop_back();
+				found = true;
+			}
+		unlockMutex(&victim.lock, TASK_LOCK);
+		if (found)
+			return true;
+	}
+	return false;
+}
@@ -0,0 +1,1732 @@
+//
+//  simulation.cpp
+//  Final Project CSC412
+//
+//  Created by Jean-Yves Hervé on 2020-12-01
+//	This is public domain code.  By all means appropriate it and change is to your
+//	heart's content.
+//
+//	The simulation side of the program (grid, partitions, traveler threads),
+//	shared by the GUI build (main.cpp) and the headless build (headless.cpp).
+#include <iostream>
+#include <string>
+#include <random>
+#include <atomic>
+#include <algorithm>
+//
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <climits>
+#include <stdint.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <new>
+//
+#include "simulation.h"
+
+using namespace std;
+
+//==================================================================================
+//	Custom data types
+//==================================================================================
+
+//	Outcome of a move attempt
+enum MoveResult
+{
+	MOVED = 0,
+	//	a direction was open, but the square was taken first or the
+	//	partition there could not be pushed
+	MOVE_FAILED,
+	//	boxed in: no direction is open
+	MOVE_BLOCKED
+};
+
+//==================================================================================
+//	Function prototypes
+//==================================================================================
+MoveResult tryMoveTraveler(unsigned int index);
+unsigned int openDirections(unsigned int row, unsigned int col, Direction forbiddenDir);
+Direction randomDirectionIn(RandomState& random, unsigned int directions);
+void parkBlockedTraveler(unsigned int index);
+SquareType claimSquare(unsigned int row, unsigned int col, SquareType newType);
+void releaseSquare(unsigned int row, unsigned int col);
+void shiftPartition(unsigned int row, unsigned int col, RandomState& random);
+bool advanceTraveler(unsigned int index, unsigned int newRow, unsigned int newCol,
+					 Direction newDir, TravelerSegment& tail);
+void removeTraveler(unsigned int index);
+void slidePartition(unsigned int id, unsigned int newRow, unsigned int newCol,
+					unsigned int oldRow, unsigned int oldCol);
+GridPosition getNewFreePosition(void);
+void addFreeSquare(unsigned int square);
+void removeFreeSquare(unsigned int square);
+Direction newDirection(RandomState& random, Direction forbiddenDir = NUM_DIRECTIONS);
+TravelerSegment newTravelerSegment(const TravelerSegment& currentSeg, bool& canAdd);
+void generateMaze(void);
+void loadMaze(const MazeFile& maze);
+void generateWalls(void);
+void generatePartitions(void);
+void allocateTravelerStore(void);
+void freeTravelerStore(void);
+void reserveSegmentArena(void);
+unsigned int allocateSegments(unsigned int count);
+void releaseSegments(unsigned int offset, unsigned int count);
+void growTravelerBody(unsigned int index);
+
+//==================================================================================
+//	Application-level global variables
+//==================================================================================
+
+//	Don't rename any of these variables
+//-------------------------------------
+//	The state grid and its dimensions (arguments to the program)
+atomic<unsigned char> * grid;
+unsigned int gridStride = 0;
+unsigned int numRows = 0;	//	height of the grid
+unsigned int numCols = 0;	//	width
+unsigned int numTravelers = 0;	//	initial number
+unsigned int numTravelersDone = 0;
+unsigned int numLiveThreads = 0;		//	the number of live traveler threads
+unsigned int numMovesForGrowth = 0;		// the number of moves before tail growth
+TravelerStore travelers;
+vector<SlidingPartition> partitionList;
+GridPosition	exitPos;	//	location of the exit
+
+//	travelers' sleep time between moves (in microseconds)
+int travelerSleepTime = 100000;
+
+//	Random generators.  The maze (walls, partitions, exit and initial
+//	travelers) is generated from stream 0 of the seed, and traveler k draws
+//	its moves from stream k+1, so that a given seed always gives the same maze
+//	and the same choices to each traveler (--seed=N; a random seed otherwise).
+const unsigned int MAX_NUM_INITIAL_SEGMENTS = 6;
+unsigned long long randomSeed = 0;
+bool seedGiven = false;
+RandomState mazeRandom;
+//	With --nav=flow, a traveler whose way to the exit is blocked takes a
+//	random detour once every FLOW_DETOUR_ODDS attempts, so that two travelers
+//	facing each other don't wait forever
+const unsigned int FLOW_DETOUR_ODDS = 4;
+//	A traveler thread whose move failed although some direction was open waits
+//	twice as long each time it fails, up to a limit (in microseconds).  One
+//	boxed in by other travelers is parked until one of them moves away.  The
+//	worker pool and the tiles wait the same way after a tick in which no
+//	traveler moved.
+const unsigned int MIN_BLOCKED_WAIT = 100;
+const unsigned int MAX_BLOCKED_WAIT = 3200;
+
+// Mutex locks
+pthread_mutex_t globalLock;
+pthread_mutex_t * gridLocks;
+// One sequence counter per traveler, odd while the traveler's thread or task
+// updates its segment list.  The renderer copies a traveler and keeps the copy
+// only if the counter didn't change meanwhile, so it never blocks a traveler.
+atomic<unsigned int> * travelerSeq;
+
+// Occupancy engine selected at startup (--engine=mutex|atomic).  Both work
+// on the same grid bytes; the mutex engine adds one lock per square.
+OccupancyEngine occupancyEngine = MUTEX_ENGINE;
+// Row alignment of the grid, in bytes (a cache line)
+const unsigned int GRID_ALIGNMENT = 64;
+// One busy flag per sliding partition, so that only one traveler at a time
+// can shift a given partition
+atomic_flag * partitionFlags = NULL;
+// One sequence counter per partition, odd while the partition slides, so
+// that the renderer and the export thread copy its extent whole, as they do
+// the travelers.  The partition's flag holder is its only writer.
+atomic<unsigned int> * partitionSeq = NULL;
+// How travelers are run (--scheduler=threads|pool|tiles, --workers=N)
+SchedulerMode schedulerMode = THREAD_SCHEDULER;
+unsigned int numWorkers = 0;
+// For each square (row-major), the index in partitionList of the partition
+// occupying it, or NO_PARTITION.  Kept in sync when a partition slides.
+// Stored plus one, so that a zero page is all NO_PARTITION: use partitionAt
+// and setPartitionAt.
+const unsigned short NO_PARTITION = 0xFFFF;
+const unsigned int MAX_NUM_PARTITIONS = NO_PARTITION;
+atomic<unsigned short> * partitionIndex = NULL;
+
+// Arena from which the travelers' segment buffers are carved, addressed by
+// offset.  Its address space is reserved once, for more segments than the
+// travelers can hold, so it never moves; pages only get backed as they are
+// used.  A traveler that outgrows its buffer gets one twice as large and gives
+// the old one back, to a free list per size, as does a traveler that exits.
+const unsigned int SEGMENT_CHUNK = 8;			//	initial capacity, a power of 2
+const unsigned int MAX_CAPACITY_LOG = 32;
+TravelerSegment* segmentArena = NULL;
+size_t arenaSize = 0;							//	in segments
+unsigned int arenaUsed = 0;
+vector<unsigned int> freeSegments[MAX_CAPACITY_LOG];
+pthread_mutex_t arenaLock;
+
+// Headless benchmark mode (--headless, --budget=seconds)
+bool headlessMode = false;
+double headlessBudget = 60.0;
+// Set to ask all traveler threads to leave, whether they reached the exit or not
+atomic<bool> stopRequested(false);
+// Time spent waiting for a mutex, summed over all traveler threads that
+// have terminated.  Each thread accumulates its own count while running.
+atomic<unsigned long long> totalLockWaitNs(0);
+thread_local unsigned long long lockWaitNs = 0;
+// Move attempts that found no open direction, or lost every open one to
+// another traveler, counted the same way
+atomic<unsigned long long> totalFailedMoves(0);
+thread_local unsigned long long failedMoves = 0;
+// Start time of the traveler threads
+struct timespec launchTimeSpec;
+
+// The free squares (numbered row * numCols + col) while the maze is built,
+// so that a random free square is found in constant time however full the
+// grid gets.  freeSlot gives the place of each free square in freeSquares, or
+// NO_SLOT; a square is removed by moving the last one into its place.  Random
+// draws find a free square quickly while the grid is mostly free, so the
+// index is only built (8 bytes per square) once they start to miss.  It is
+// then kept up to date by setSquare, and released once the travelers are
+// placed: the travelers' moves don't maintain it, so it can't be used to add
+// travelers while the simulation runs.
+const unsigned int MAX_FREE_SQUARE_DRAWS = 64;
+const unsigned int NO_SLOT = UINT_MAX;
+vector<unsigned int> freeSquares;
+vector<unsigned int> freeSlot;
+
+//	Reads or writes a square during initialization, before the travelers start
+inline SquareType squareAt(unsigned int row, unsigned int col)
+{
+	return static_cast<SquareType>(grid[squareIndex(row, col)].load(memory_order_relaxed));
+}
+
+inline void setSquare(unsigned int row, unsigned int col, SquareType type)
+{
+	atomic<unsigned char>& square = grid[squareIndex(row, col)];
+	bool wasFree = square.load(memory_order_relaxed) == FREE_SQUARE;
+	square.store(static_cast<unsigned char>(type), memory_order_relaxed);
+	if (freeSlot.empty())
+		return;
+	if (wasFree && type != FREE_SQUARE)
+		removeFreeSquare(row * numCols + col);
+	else if (!wasFree && type == FREE_SQUARE)
+		addFreeSquare(row * numCols + col);
+}
+
+//	A traveler has a single writer (the thread or task running it), so the
+//	sequence counter needs no atomic increment
+inline void beginTravelerUpdate(unsigned int index)
+{
+	travelerSeq[index].store(travelerSeq[index].load(memory_order_relaxed) + 1, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+}
+
+inline void endTravelerUpdate(unsigned int index)
+{
+	travelerSeq[index].store(travelerSeq[index].load(memory_order_relaxed) + 1, memory_order_release);
+}
+
+//	Segment i of traveler index, 0 being the head
+inline TravelerSegment& bodySegment(unsigned int index, unsigned int i)
+{
+	return segmentArena[travelers.bodyOffset[index] +
+						((travelers.bodyHead[index] + i) & (travelers.capacity[index] - 1))];
+}
+
+//	An entry past the partition list (in a maze file that was not verified)
+//	reads as NO_PARTITION
+inline unsigned short partitionAt(unsigned int row, unsigned int col)
+{
+	unsigned short id = partitionIndex[row * numCols + col].load(memory_order_relaxed) - 1;
+	return id < partitionList.size() ? id : NO_PARTITION;
+}
+
+inline void setPartitionAt(unsigned int row, unsigned int col, unsigned short id)
+{
+	partitionIndex[row * numCols + col].store(id + 1, memory_order_relaxed);
+}
+
+//	Parses the command line: rows cols numTravelers [numMovesForGrowth],
+//	plus options of the form --name=value that can appear anywhere.
+//	Prints a usage message and returns false if the arguments are invalid.
+bool parseArguments(int argc, char** argv)
+{
+	//	We know that the arguments  of the program  are going
+	//	to be the width (number of columns) and height (number of rows) of the
+	//	grid, the number of travelers, etc.
+	//  Parse inputs.  Options of the form --name=value can appear anywhere
+	//	and are removed from the positional arguments
+	vector<char*> posArgs;
+	for (int k = 1; k < argc; k++)
+	{
+		if (strncmp(argv[k], "--", 2) != 0)
+			posArgs.push_back(argv[k]);
+		else if (!parseOption(argv[k]))
+		{
+			cerr << "Unknown option " << argv[k] << endl;
+			return false;
+		}
+	}
+	//	A maze file gives the dimensions and the number of travelers, and a
+	//	checkpoint also the number of moves before tail growth
+	if (!mazePath.empty() && posArgs.size() <= (restoreState ? 0 : 1))
+	{
+		if (posArgs.size() == 1)
+			numMovesForGrowth = atoi(posArgs[0]);
+		else
+			numMovesForGrowth = INT_MAX;
+	}
+	else if (mazePath.empty() && (posArgs.size() == 3 || posArgs.size() == 4))
+	{
+		numRows = atoi(posArgs[0]);
+		numCols = atoi(posArgs[1]);
+		numTravelers = atoi(posArgs[2]);
+		if (posArgs.size() == 4)
+			numMovesForGrowth = atoi(posArgs[3]);
+		else
+			numMovesForGrowth = INT_MAX;
+	}
+	else
+	{
+		cerr << "Usage: " << argv[0] << " rows cols numTravelers [numMovesForGrowth]"
+			 << " [--engine=mutex|atomic] [--scheduler=threads|pool|tiles] [--workers=N]"
+			 << " [--nav=random|flow] [--seed=N] [--headless] [--budget=seconds]"
+			 << " [--journal=file] [--save-maze=file] [--checkpoint=file] [--export=name]" << endl;
+		cerr << "   or: " << argv[0] << " [numMovesForGrowth] --maze=file [--verify-maze] [options]" << endl;
+		cerr << "   or: " << argv[0] << " --restore=file [options]" << endl;
+		return false;
+	}
+	return true;
+}
+
+//	Reads a square, without locking, so the value may already be stale.
+//	The squares of the border (row or column -1 or numRows/numCols) are walls.
+SquareType getSquare(unsigned int row, unsigned int col)
+{
+	return static_cast<SquareType>(grid[squareIndex(row, col)].load(memory_order_relaxed));
+}
+
+//	Partitions for the renderer.  A partition is copied while it may be
+//	sliding: the copy is whole, but its position may already be stale.
+unsigned int getNumPartitions(void)
+{
+	return partitionList.size();
+}
+
+SlidingPartition getPartition(unsigned int index)
+{
+	while (true)
+	{
+		unsigned int seq = partitionSeq[index].load(memory_order_acquire);
+		if (seq & 1)
+		{
+			sched_yield();
+			continue;
+		}
+		SlidingPartition copy = partitionList[index];
+		atomic_thread_fence(memory_order_acquire);
+		if (partitionSeq[index].load(memory_order_relaxed) == seq)
+			return copy;
+	}
+}
+
+//	Copies a traveler for the renderer, without blocking its thread: the copy
+//	is started over if the traveler moved meanwhile.  The copy's segments are
+//	stored in segments, head first.  Returns the traveler's length (0 if it has
+//	exited, in which case there is nothing to draw).
+unsigned int snapshotTraveler(unsigned int index, Traveler& copy, vector<TravelerSegment>& segments)
+{
+	while (true)
+	{
+		unsigned int seq = travelerSeq[index].load(memory_order_acquire);
+		if (seq & 1)
+		{
+			sched_yield();
+			continue;
+		}
+		unsigned int offset = travelers.bodyOffset[index];
+		unsigned int capacity = travelers.capacity[index];
+		unsigned int head = travelers.bodyHead[index];
+		unsigned int length = travelers.length[index];
+		// Make sure the buffer fields go together before reading the body
+		atomic_thread_fence(memory_order_acquire);
+		if (travelerSeq[index].load(memory_order_relaxed) != seq)
+			continue;
+		// The buffer is at least a power of 2 larger than the length,
+		// so that segmentAt works on the copy
+		unsigned int copyCapacity = 1;
+		while (copyCapacity < length)
+			copyCapacity *= 2;
+		if (segments.size() < copyCapacity)
+			segments.resize(copyCapacity);
+		for (unsigned int i = 0; i < length; i++)
+			segments[i] = segmentArena[offset + ((head + i) & (capacity - 1))];
+		atomic_thread_fence(memory_order_acquire);
+		if (travelerSeq[index].load(memory_order_relaxed) != seq)
+			continue;
+		copy.index = index;
+		for (unsigned int k = 0; k < 4; k++)
+			copy.rgba[k] = travelers.rgba[4*index + k];
+		copy.body = segments.data();
+		copy.capacity = copyCapacity;
+		copy.head = 0;
+		copy.length = length;
+		return length;
+	}
+}
+
+//	Copies a traveler's head segment for the renderer, the way snapshotTraveler
+//	copies its whole body.  Returns the traveler's length (0 if it has exited,
+//	in which case head is not set).
+unsigned int snapshotTravelerHead(unsigned int index, TravelerSegment& head)
+{
+	while (true)
+	{
+		unsigned int seq = travelerSeq[index].load(memory_order_acquire);
+		if (seq & 1)
+		{
+			sched_yield();
+			continue;
+		}
+		unsigned int offset = travelers.bodyOffset[index];
+		unsigned int capacity = travelers.capacity[index];
+		unsigned int bodyHead = travelers.bodyHead[index];
+		unsigned int length = travelers.length[index];
+		atomic_thread_fence(memory_order_acquire);
+		if (travelerSeq[index].load(memory_order_relaxed) != seq)
+			continue;
+		if (length > 0)
+			head = segmentArena[offset + (bodyHead & (capacity - 1))];
+		atomic_thread_fence(memory_order_acquire);
+		if (travelerSeq[index].load(memory_order_relaxed) != seq)
+			continue;
+		return length;
+	}
+}
+
+
+//	Locks a mutex, adding the time spent waiting for it to the calling
+//	thread's lock wait count.  The clock is only read if the mutex is taken.
+//	The lock's class, and its square for a grid lock, are for the lock
+//	statistics.
+void lockMutex(pthread_mutex_t* mutex, LockClass lockClass, unsigned int square)
+{
+	if (pthread_mutex_trylock(mutex) == 0)
+	{
+		recordLockAcquired(lockClass, square, false, 0);
+		return;
+	}
+	struct timespec start, end;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	pthread_mutex_lock(mutex);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	unsigned long long waitNs = (end.tv_sec - start.tv_sec) * 1000000000ULL + end.tv_nsec - start.tv_nsec;
+	lockWaitNs += waitNs;
+	recordLockAcquired(lockClass, square, true, waitNs);
+}
+
+//	Returns the time elapsed since the traveler threads were launched, in seconds
+double elapsedSeconds(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - launchTimeSpec.tv_sec) + 1E-9 * (now.tv_nsec - launchTimeSpec.tv_nsec);
+}
+
+//==================================================================================
+//
+//	This is a function that you have to edit and add to.
+//
+//==================================================================================
+
+//	Move protocol.  A traveler never holds more than one square lock at a
+//	time: it claims the square its head moves into, then releases its tail
+//	square, each as a separate step.  In between, the traveler briefly occupies
+//	both squares, which is harmless.  A partition shift likewise claims the
+//	square the partition slides into before releasing the one it leaves.
+//	Since no thread ever waits for a square lock while holding another one,
+//	there is no lock ordering to respect and no deadlock is possible.
+//	globalLock is only used for the numTravelersDone/numLiveThreads counters.
+//	The renderer reads the segment lists through snapshotTraveler, without
+//	any lock.
+
+//	Claims a free square for newType.  Returns the type the square had, so the
+//	claim succeeded if and only if FREE_SQUARE is returned.
+//	A square that is not free is reported without locking it, which also
+//	keeps the border squares from ever being locked.
+SquareType claimSquare(unsigned int row, unsigned int col, SquareType newType)
+{
+	atomic<unsigned char>& square = grid[squareIndex(row, col)];
+	if (occupancyEngine == ATOMIC_ENGINE)
+	{
+		unsigned char expected = FREE_SQUARE;
+		square.compare_exchange_strong(expected, static_cast<unsigned char>(newType),
+									   memory_order_acq_rel);
+		return static_cast<SquareType>(expected);
+	}
+	SquareType state = static_cast<SquareType>(square.load(memory_order_relaxed));
+	if (state != FREE_SQUARE)
+		return state;
+	unsigned int lock = row * numCols + col;
+	lockMutex(&gridLocks[lock], GRID_LOCK, lock);
+		state = static_cast<SquareType>(square.load(memory_order_relaxed));
+		if (state == FREE_SQUARE)
+			square.store(static_cast<unsigned char>(newType), memory_order_relaxed);
+	unlockMutex(&gridLocks[lock], GRID_LOCK, lock);
+	return state;
+}
+
+//	Gives back a square previously claimed with claimSquare
+void releaseSquare(unsigned int row, unsigned int col)
+{
+	atomic<unsigned char>& square = grid[squareIndex(row, col)];
+	if (occupancyEngine == ATOMIC_ENGINE)
+		square.store(FREE_SQUARE, memory_order_release);
+	else
+	{
+		unsigned int lock = row * numCols + col;
+		lockMutex(&gridLocks[lock], GRID_LOCK, lock);
+			square.store(FREE_SQUARE, memory_order_relaxed);
+		unlockMutex(&gridLocks[lock], GRID_LOCK, lock);
+	}
+	notifySquareFreed(squareIndex(row, col));
+}
+
+//	One move attempt: tries to move the traveler's head in a direction other
+//	than backward, pushing a partition if it bumps into one.  With --nav=flow,
+//	the directions leading closer to the exit are tried first, and a random
+//	direction only once in a while if they are all blocked.  Otherwise, a single
+//	random direction is tried.  Random directions are drawn among the open
+//	ones only, so that a traveler never tries to walk into a wall.
+MoveResult tryMoveTraveler(unsigned int index)
+{
+	// Only the thread or task running the traveler modifies it,
+	// so it can read it without locking.
+	// Obtain head position and direction
+	unsigned int row = travelers.headRow[index];
+	unsigned int col = travelers.headCol[index];
+	Direction backward = static_cast<Direction>((travelers.headDir[index] + 2) % NUM_DIRECTIONS);
+	RandomState& random = travelers.random[index];
+	unsigned int open = openDirections(row, col, backward);
+	if (open == 0)
+	{
+		failedMoves++;
+		return MOVE_BLOCKED;
+	}
+	// Directions to try, in order of preference
+	Direction choices[NUM_DIRECTIONS];
+	unsigned int numChoices = 0;
+	if (navigationMode == FLOW_NAVIGATION)
+		numChoices = flowDirections(row, col, backward, choices, random);
+	if (numChoices == 0 || randomBelow(random, FLOW_DETOUR_ODDS) == 0)
+		choices[numChoices++] = randomDirectionIn(random, open);
+	Direction newDir = NUM_DIRECTIONS;
+	unsigned int newRow = row;
+	unsigned int newCol = col;
+	for (unsigned int k = 0; k < numChoices && newDir == NUM_DIRECTIONS; k++)
+	{
+		// Not open when the squares were read
+		if ((open & (1U << choices[k])) == 0)
+			continue;
+		// Off the grid, the square is part of the border of walls
+		neighborSquare(row, col, choices[k], newRow, newCol);
+		// Try to claim the next position if it is free.  The exit is never claimed.
+		SquareType state = claimSquare(newRow, newCol, TRAVELER);
+		if (state == FREE_SQUARE || state == EXIT)
+			newDir = choices[k];
+		// If partition, try to push it
+		else if (state == VERTICAL_PARTITION || state == HORIZONTAL_PARTITION)
+			shiftPartition(newRow, newCol, random);
+	}
+	if (newDir == NUM_DIRECTIONS)
+	{
+		failedMoves++;
+		return MOVE_FAILED;
+	}
+	TravelerSegment tail;
+	bool releaseTail = advanceTraveler(index, newRow, newCol, newDir, tail);
+	// The event is journaled while the traveler holds both squares, so that
+	// the journal's order agrees with the order in which squares changed hands
+	if (journalEnabled)
+		journalEvent(releaseTail ? JOURNAL_MOVE : JOURNAL_GROWTH, index, travelers.totalMoves[index],
+					 row, col, newRow, newCol, newDir);
+	if (releaseTail)
+		releaseSquare(tail.row, tail.col);
+	return MOVED;
+}
+
+//	Returns the directions other than forbiddenDir in which the head at
+//	(row, col) can go, as a bit mask (bit d for direction d): those of a free
+//	square, of the exit, or of a partition that could be pushed.  The squares
+//	are read in one pass, without locking.
+unsigned int openDirections(unsigned int row, unsigned int col, Direction forbiddenDir)
+{
+	unsigned int square = squareIndex(row, col);
+	unsigned int open = 0;
+	for (unsigned int d = 0; d < NUM_DIRECTIONS; d++)
+	{
+		SquareType type = static_cast<SquareType>(
+			grid[neighborIndex(square, static_cast<Direction>(d))].load(memory_order_relaxed));
+		if (d != forbiddenDir && type != WALL && type != TRAVELER)
+			open |= 1U << d;
+	}
+	return open;
+}
+
+//	Parks a traveler that has no open direction on the squares of the
+//	travelers around its head.  Walls never move, so they are left out.
+void parkBlockedTraveler(unsigned int index)
+{
+	unsigned int square = squareIndex(travelers.headRow[index], travelers.headCol[index]);
+	Direction backward = static_cast<Direction>((travelers.headDir[index] + 2) % NUM_DIRECTIONS);
+	unsigned int squares[NUM_DIRECTIONS];
+	unsigned int numSquares = 0;
+	for (unsigned int d = 0; d < NUM_DIRECTIONS; d++)
+	{
+		unsigned int neighbor = neighborIndex(square, static_cast<Direction>(d));
+		if (d != backward && grid[neighbor].load(memory_order_relaxed) == TRAVELER)
+			squares[numSquares++] = neighbor;
+	}
+	parkTraveler(index, squares, numSquares);
+}
+
+//	Picks one of the directions of a non-empty bit mask, with equal odds
+Direction randomDirectionIn(RandomState& random, unsigned int directions)
+{
+	unsigned int k = randomBelow(random, __builtin_popcount(directions));
+	// Drop the k lowest directions of the mask
+	while (k-- > 0)
+		directions &= directions - 1;
+	return static_cast<Direction>(__builtin_ctz(directions));
+}
+
+//	Puts the head of a traveler on square (newRow, newCol), which it has
+//	claimed, growing the traveler if it is time to.  Returns true, with the
+//	tail segment, if the tail square is left and must be released.
+bool advanceTraveler(unsigned int index, unsigned int newRow, unsigned int newCol,
+					 Direction newDir, TravelerSegment& tail)
+{
+	bool releaseTail = false;
+	tail = bodySegment(index, travelers.length[index] - 1);
+	beginTravelerUpdate(index);
+		// Increase number of moves
+		travelers.moves[index]++;
+		travelers.totalMoves[index]++;
+		// If it is the time to increase the length, keep the last segment
+		if (travelers.moves[index] == numMovesForGrowth)
+		{
+			if (travelers.length[index] == travelers.capacity[index])
+				growTravelerBody(index);
+			travelers.length[index]++;
+			// Reset counter
+			travelers.moves[index] = 0;
+		}
+		// Otherwise, the last position will be freed.  When the buffer
+		// is full, the new head overwrites the last segment.
+		else
+			releaseTail = true;
+		// Set head at the new position, in front of the old one
+		travelers.bodyHead[index] = (travelers.bodyHead[index] - 1) & (travelers.capacity[index] - 1);
+		bodySegment(index, 0) = {newRow, newCol, newDir};
+		travelers.headRow[index] = newRow;
+		travelers.headCol[index] = newCol;
+		travelers.headDir[index] = newDir;
+	endTravelerUpdate(index);
+	return releaseTail;
+}
+
+//	Returns true if the traveler's head is on the exit square
+bool travelerAtExit(unsigned int index)
+{
+	return travelers.headRow[index] == exitPos.row && travelers.headCol[index] == exitPos.col;
+}
+
+//	Takes a traveler out of the simulation, once its head is on the exit or
+//	when stopRequested is set.  A traveler stopped by stopRequested didn't
+//	solve the maze: it stays frozen where it is.
+void retireTraveler(unsigned int index)
+{
+	bool solved = travelerAtExit(index);
+	if (solved)
+		travelers.exitTime[index] = runTimeSeconds();
+	if (solved)
+	{
+		if (journalEnabled)
+			journalEvent(JOURNAL_EXIT, index, travelers.totalMoves[index], travelers.headRow[index],
+						 travelers.headCol[index], travelers.headRow[index], travelers.headCol[index],
+						 travelers.headDir[index]);
+		removeTraveler(index);
+	}
+	// This thread's journal records must be written before the main thread
+	// can see that all travelers are done and close the journal
+	if (journalEnabled)
+		flushJournal();
+	// Update global information.  The thread's lock statistics must be in
+	// before the main thread can see that all travelers are done.
+	lockMutex(&globalLock, GLOBAL_LOCK);
+		if (solved)
+			numTravelersDone++;
+		totalLockWaitNs += lockWaitNs;
+		lockWaitNs = 0;
+		totalFailedMoves += failedMoves;
+		failedMoves = 0;
+		flushLockStats();
+		numLiveThreads--;
+	unlockMutex(&globalLock, GLOBAL_LOCK);
+}
+
+//	Takes a traveler that reached the exit off the grid, releasing the squares
+//	of its body (but not the exit, which is never claimed) and its segments
+void removeTraveler(unsigned int index)
+{
+	beginTravelerUpdate(index);
+		// Free all squares occupied by traveler
+		for (unsigned int i = 1; i < travelers.length[index]; i++)
+			releaseSquare(bodySegment(index, i).row, bodySegment(index, i).col);
+		// Remove traveler segments all at once
+		travelers.length[index] = 0;
+		travelers.pid[index] = 0;
+		releaseSegments(travelers.bodyOffset[index], travelers.capacity[index]);
+	endTravelerUpdate(index);
+}
+
+//	One tick of a traveler run as a task by the worker pool: a single move
+//	attempt.  Sets moved if the traveler moved.  Returns false once the
+//	traveler has left the simulation and must not be rescheduled.
+bool travelerStep(unsigned int index, bool& moved)
+{
+	if (stopRequested.load(memory_order_relaxed) || travelerAtExit(index))
+	{
+		retireTraveler(index);
+		return false;
+	}
+	if (tryMoveTraveler(index) == MOVED)
+		moved = true;
+	return true;
+}
+
+//	Called by one worker of the pool or the tiles between two ticks.  Sleeps
+//	travelerSleepTime, or longer while the travelers are jammed: with no
+//	sleep time, the ticks would otherwise run back to back, failing every
+//	move.  waitTime is the backoff, kept from one tick to the next.
+void sleepBetweenTicks(bool moved, unsigned int& waitTime)
+{
+	if (moved)
+		waitTime = 0;
+	else
+		waitTime = min(2 * max(waitTime, MIN_BLOCKED_WAIT / 2), MAX_BLOCKED_WAIT);
+	unsigned int sleepTime = max(travelerSleepTime, 0);
+	if (max(sleepTime, waitTime) > 0)
+		usleep(max(sleepTime, waitTime));
+}
+
+//	Thread function of a traveler, with --scheduler=threads (one thread per
+//	traveler)
+void *travelerFunc(void *arg)
+{
+	// Obtain traveler's index
+	unsigned int index = (unsigned int)(uintptr_t)arg;
+	// Loop until the exit is reached
+	unsigned int waitTime = 0;
+	while (!stopRequested.load(memory_order_relaxed) && !travelerAtExit(index))
+	{
+		checkPause();
+		MoveResult result = tryMoveTraveler(index);
+		if (result == MOVED)
+		{
+			waitTime = 0;
+			// Delay
+			if (travelerSleepTime > 0)
+				usleep(travelerSleepTime);
+		}
+		// Boxed in: sleep until a neighbor moves away
+		else if (result == MOVE_BLOCKED)
+		{
+			waitTime = 0;
+			parkBlockedTraveler(index);
+		}
+		// A first failure while some direction was open most likely lost a
+		// race for a square: retry at once.  Otherwise, wait for a neighbor
+		// to move away, longer each time.
+		else if (waitTime == 0)
+			waitTime = MIN_BLOCKED_WAIT / 2;
+		else
+		{
+			waitTime = min(2 * max(waitTime, MIN_BLOCKED_WAIT / 2), MAX_BLOCKED_WAIT);
+			usleep(waitTime);
+		}
+	}
+	retireTraveler(index);
+	removeRunner();
+	return NULL;
+}
+
+//	Try to slide the partition that occupies square (row, col) by one square
+//	along its axis.  The owner is found in constant time through the
+//	partitionIndex.  Gives up without waiting if another traveler is already
+//	shifting that partition, or if the square the partition would slide into
+//	cannot be claimed.
+void shiftPartition(unsigned int row, unsigned int col, RandomState& random)
+{
+	unsigned short id = partitionAt(row, col);
+	// The partition just slid away from that square
+	if (id == NO_PARTITION)
+		return;
+	// Partition busy: we don't wait
+	if (partitionFlags[id].test_and_set(memory_order_acquire))
+	{
+		recordLockFailed(PARTITION_FLAG, row * numCols + col);
+		return;
+	}
+	recordLockAcquired(PARTITION_FLAG, row * numCols + col, false, 0);
+	SlidingPartition * partition = &partitionList[id];
+	// The index may have been read just before the partition slid
+	unsigned int first = partition->isVertical ? partition->start.row : partition->start.col;
+	unsigned int offset = partition->isVertical ? row - partition->start.row : col - partition->start.col;
+	bool found = partition->isVertical ? col == partition->start.col : row == partition->start.row;
+	if (!found || offset >= partition->length)
+	{
+		recordLockReleased(PARTITION_FLAG, row * numCols + col);
+		partitionFlags[id].clear(memory_order_release);
+		return;
+	}
+	unsigned int last = first + partition->length - 1;
+	// Slide toward the top/left or the bottom/right
+	bool backward = randomBelow(random, 2);
+	unsigned int limit = partition->isVertical ? numRows : numCols;
+	if ((backward && first > 0) || (!backward && last < limit - 1))
+	{
+		// New partition block to add, current partition block to remove
+		unsigned int newEnd = backward ? first - 1 : last + 1;
+		unsigned int oldEnd = backward ? last : first;
+		unsigned int row1 = partition->isVertical ? newEnd : row;
+		unsigned int col1 = partition->isVertical ? col : newEnd;
+		unsigned int row2 = partition->isVertical ? oldEnd : row;
+		unsigned int col2 = partition->isVertical ? col : oldEnd;
+		// Claim the square the partition slides into, then release the one it leaves
+		if (claimSquare(row1, col1, partition->isVertical ? VERTICAL_PARTITION : HORIZONTAL_PARTITION) == FREE_SQUARE)
+		{
+			slidePartition(id, row1, col1, row2, col2);
+			if (journalEnabled)
+				journalEvent(JOURNAL_SHIFT, id, 0, row2, col2, row1, col1,
+							 partition->isVertical ? (backward ? NORTH : SOUTH) : (backward ? WEST : EAST));
+			releaseSquare(row2, col2);
+			// Repaired before the partition is released, so that the repairs
+			// for a given partition are made in the order of its moves
+			if (navigationMode == FLOW_NAVIGATION)
+				repairExitDistances(row1, col1, row2, col2);
+		}
+	}
+	recordLockReleased(PARTITION_FLAG, row * numCols + col);
+	partitionFlags[id].clear(memory_order_release);
+}
+
+//	Moves partition id, which has claimed square (newRow, newCol) at one of its
+//	ends, off square (oldRow, oldCol) at the other end.  The square left is
+//	released by the caller.
+void slidePartition(unsigned int id, unsigned int newRow, unsigned int newCol,
+					unsigned int oldRow, unsigned int oldCol)
+{
+	SlidingPartition& partition = partitionList[id];
+	setPartitionAt(newRow, newCol, id);
+	setPartitionAt(oldRow, oldCol, NO_PARTITION);
+	partitionSeq[id].store(partitionSeq[id].load(memory_order_relaxed) + 1, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+		if (partition.isVertical)
+			partition.start.row = min(newRow, oldRow + 1);
+		else
+			partition.start.col = min(newCol, oldCol + 1);
+	partitionSeq[id].store(partitionSeq[id].load(memory_order_relaxed) + 1, memory_order_release);
+}
+
+//	Applies one journal record to the grid, the partitions and the travelers,
+//	for the replay tool.  The replay has a single thread, so squares are set
+//	rather than claimed.  Returns false if the record doesn't fit the current
+//	state, which means the journal was not recorded on this maze.
+bool applyJournalRecord(const JournalRecord& record)
+{
+	unsigned int numSquares = numRows * numCols;
+	if (record.from >= numSquares || record.to >= numSquares || record.dir >= NUM_DIRECTIONS)
+		return false;
+	unsigned int fromRow = record.from / numCols, fromCol = record.from % numCols;
+	unsigned int toRow = record.to / numCols, toCol = record.to % numCols;
+	atomic<unsigned char>& target = grid[squareIndex(toRow, toCol)];
+	SquareType state = static_cast<SquareType>(target.load(memory_order_relaxed));
+	switch (record.type)
+	{
+		case JOURNAL_MOVE:
+		case JOURNAL_GROWTH:
+		{
+			if (record.id >= travelers.count || travelers.length[record.id] == 0 ||
+				travelers.headRow[record.id] != fromRow || travelers.headCol[record.id] != fromCol)
+				return false;
+			if (state == FREE_SQUARE)
+				target.store(TRAVELER, memory_order_relaxed);
+			else if (state != EXIT)
+				return false;
+			TravelerSegment tail;
+			bool releaseTail = advanceTraveler(record.id, toRow, toCol, static_cast<Direction>(record.dir), tail);
+			if (releaseTail)
+				grid[squareIndex(tail.row, tail.col)].store(FREE_SQUARE, memory_order_relaxed);
+			//	Growth only depends on numMovesForGrowth, which the journal records
+			return releaseTail == (record.type == JOURNAL_MOVE);
+		}
+		case JOURNAL_EXIT:
+			if (record.id >= travelers.count || travelers.length[record.id] == 0 || !travelerAtExit(record.id))
+				return false;
+			removeTraveler(record.id);
+			return true;
+		case JOURNAL_SHIFT:
+			if (record.id >= partitionList.size() || state != FREE_SQUARE ||
+				partitionAt(fromRow, fromCol) != record.id)
+				return false;
+			target.store(partitionList[record.id].isVertical ? VERTICAL_PARTITION : HORIZONTAL_PARTITION,
+						 memory_order_relaxed);
+			slidePartition(record.id, toRow, toCol, fromRow, fromCol);
+			grid[squareIndex(fromRow, fromCol)].store(FREE_SQUARE, memory_order_relaxed);
+			return true;
+		default:
+			return false;
+	}
+}
+
+//	Parse one --name=value command line option.  Returns false if the option
+//	is not recognized.
+bool parseOption(const char* arg)
+{
+	if (strcmp(arg, "--engine=mutex") == 0)
+		occupancyEngine = MUTEX_ENGINE;
+	else if (strcmp(arg, "--engine=atomic") == 0)
+		occupancyEngine = ATOMIC_ENGINE;
+	else if (strcmp(arg, "--scheduler=threads") == 0)
+		schedulerMode = THREAD_SCHEDULER;
+	else if (strcmp(arg, "--scheduler=pool") == 0)
+		schedulerMode = POOL_SCHEDULER;
+	else if (strcmp(arg, "--scheduler=tiles") == 0)
+		schedulerMode = TILE_SCHEDULER;
+	else if (strncmp(arg, "--workers=", 10) == 0)
+		numWorkers = atoi(arg + 10);
+	else if (strcmp(arg, "--nav=random") == 0)
+		navigationMode = RANDOM_NAVIGATION;
+	else if (strcmp(arg, "--nav=flow") == 0)
+		navigationMode = FLOW_NAVIGATION;
+	else if (strncmp(arg, "--seed=", 7) == 0)
+	{
+		randomSeed = strtoull(arg + 7, NULL, 10);
+		seedGiven = true;
+	}
+	else if (strcmp(arg, "--headless") == 0)
+		headlessMode = true;
+	else if (strncmp(arg, "--budget=", 9) == 0)
+		headlessBudget = atof(arg + 9);
+	else if (strncmp(arg, "--journal=", 10) == 0)
+		journalPath = arg + 10;
+	else if (strncmp(arg, "--maze=", 7) == 0)
+		mazePath = arg + 7;
+	else if (strcmp(arg, "--verify-maze") == 0)
+		verifyMaze = true;
+	else if (strncmp(arg, "--save-maze=", 12) == 0)
+		saveMazePath = arg + 12;
+	else if (strncmp(arg, "--checkpoint=", 13) == 0)
+		checkpointPath = arg + 13;
+	else if (strncmp(arg, "--restore=", 10) == 0)
+	{
+		mazePath = arg + 10;
+		restoreState = true;
+	}
+	else if (strncmp(arg, "--export=", 9) == 0 && arg[9] != '\0')
+		exportName = arg + 9;
+#ifdef LOCK_STATS
+	else if (strncmp(arg, "--lock-stats=", 13) == 0)
+		lockStatsPath = arg + 13;
+#endif
+	else
+		return false;
+	return true;
+}
+
+//	Builds the grid, the partitions and the travelers, and starts the travelers
+void initializeApplication(void)
+{
+	initializeSimulation();
+	initializeLockStats();
+	if (!journalPath.empty())
+		openJournal(journalPath.c_str());
+
+	// Start traveler threads.  The threads are counted as live here rather
+	// than when they start running, so that numLiveThreads only drops to 0
+	// once all of them have terminated.  The travelers of a checkpoint that
+	// had already exited are not started.
+	numLiveThreads = 0;
+	for (unsigned int k=0; k<numTravelers; k++)
+		if (travelers.length[k] > 0)
+			numLiveThreads++;
+	startCheckpointThread();
+	clock_gettime(CLOCK_MONOTONIC, &launchTimeSpec);
+	if (!exportName.empty())
+		openExport();
+	if (schedulerMode == POOL_SCHEDULER)
+		startWorkerPool();
+	else if (schedulerMode == TILE_SCHEDULER)
+		startTileWorkers();
+	else
+	{
+		initializeParking();
+		addRunners(numLiveThreads);
+		for (unsigned int k=0; k<numTravelers; k++) {
+			//  start traveler thread
+			if (travelers.length[k] > 0)
+				pthread_create(&(travelers.pid[k]), NULL, travelerFunc, (void *)(uintptr_t)k);
+		}
+	}
+}
+
+//	Builds the grid, the partitions and the travelers, from the seed or from
+//	the maze file, without starting the travelers (the replay tool applies a
+//	journal to this state)
+void initializeSimulation(void)
+{
+	numLiveThreads = 0;
+	numTravelersDone = 0;
+
+	//	A maze file gives the dimensions and the number of travelers
+	MazeFile maze;
+	if (!mazePath.empty())
+		mapMazeFile(mazePath.c_str(), maze);
+
+	// Initialize locks
+	pthread_mutex_init(&globalLock, NULL);
+	pthread_mutex_init(&arenaLock, NULL);
+	allocateTravelerStore();
+	reserveSegmentArena();
+	travelerSeq = new atomic<unsigned int>[numTravelers];
+	for (unsigned int i = 0; i < numTravelers; i++)
+		travelerSeq[i].store(0, memory_order_relaxed);
+
+	// Allocate the grid locks (the atomic engine doesn't need them)
+	if (occupancyEngine == MUTEX_ENGINE)
+	{
+		gridLocks = new pthread_mutex_t[numRows * numCols];
+		for (unsigned int i = 0; i < numRows * numCols; i++)
+			pthread_mutex_init(&gridLocks[i], NULL);
+	}
+
+	//	Initialize the random generators
+	if (!seedGiven)
+		randomSeed = (static_cast<unsigned long long>(random_device()()) << 32) | random_device()();
+	seedRandom(mazeRandom, randomSeed, 0);
+	for (unsigned int k = 0; k < numTravelers; k++)
+		seedRandom(travelers.random[k], randomSeed, k + 1);
+
+	if (!mazePath.empty())
+		loadMaze(maze);
+	else
+		generateMaze();
+
+	partitionFlags = new atomic_flag[partitionList.size()];
+	partitionSeq = new atomic<unsigned int>[partitionList.size()];
+	for (unsigned int i = 0; i < partitionList.size(); i++)
+	{
+		partitionFlags[i].clear();
+		partitionSeq[i].store(0, memory_order_relaxed);
+	}
+	//	A maze file has the partition index ready.  Otherwise it starts as
+	//	zero pages, which stand for NO_PARTITION and are only backed once
+	//	written.
+	if (!mazePath.empty())
+		partitionIndex = reinterpret_cast<atomic<unsigned short>*>(maze.partitionIndex);
+	else
+	{
+		void* index = mmap(NULL, numRows * (size_t) numCols * sizeof(atomic<unsigned short>), PROT_READ | PROT_WRITE,
+						   MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+		if (index == MAP_FAILED)
+		{
+			perror("Could not allocate the partition index");
+			exit(1);
+		}
+		partitionIndex = static_cast<atomic<unsigned short>*>(index);
+		for (unsigned int i = 0; i < partitionList.size(); i++)
+		{
+			for (unsigned int j = 0; j < partitionList[i].length; j++)
+			{
+				if (partitionList[i].isVertical)
+					setPartitionAt(partitionList[i].start.row + j, partitionList[i].start.col, i);
+				else
+					setPartitionAt(partitionList[i].start.row, partitionList[i].start.col + j, i);
+			}
+		}
+	}
+	if (navigationMode == FLOW_NAVIGATION)
+		computeExitDistances();
+	if (!saveMazePath.empty() && !saveMazeFile(saveMazePath.c_str(), false))
+		exit(1);
+}
+
+
+//	Generates a random maze (walls, partitions, exit and initial travelers)
+//	from stream 0 of the seed
+void generateMaze(void)
+{
+	//	Allocate the grid, with its border of walls.  Rows start on a cache line.
+	gridStride = (numCols + 2 + GRID_ALIGNMENT - 1) / GRID_ALIGNMENT * GRID_ALIGNMENT;
+	size_t gridSize = (numRows + 2) * (size_t) gridStride;
+	void* gridBuffer;
+	if (posix_memalign(&gridBuffer, GRID_ALIGNMENT, gridSize) != 0)
+	{
+		cerr << "Could not allocate the grid" << endl;
+		exit(1);
+	}
+	grid = static_cast<atomic<unsigned char>*>(gridBuffer);
+	for (size_t i = 0; i < gridSize; i++)
+		new (&grid[i]) atomic<unsigned char>(WALL);
+	for (unsigned int i=0; i<numRows; i++)
+		for (unsigned int j=0; j< numCols; j++)
+			setSquare(i, j, FREE_SQUARE);
+
+	//---------------------------------------------------------------
+	//	All the code below to be replaced/removed
+	//	I initialize the grid's pixels to have something to look at
+	//---------------------------------------------------------------
+
+	//	generate a random exit
+	exitPos = getNewFreePosition();
+	setSquare(exitPos.row, exitPos.col, EXIT);
+
+	//	Generate walls and partitions
+	generateWalls();
+	generatePartitions();
+	
+	//	Initialize traveler info structs
+	//	You will probably need to replace/complete this as you add thread-related data
+	float** travelerColor = createTravelerColors(numTravelers);
+	for (unsigned int k=0; k<numTravelers; k++) {
+		GridPosition pos = getNewFreePosition();
+		//	Note that treating an enum as a sort of integer is increasingly
+		//	frowned upon, as C++ versions progress
+		Direction dir = static_cast<Direction>(randomBelow(mazeRandom, NUM_DIRECTIONS));
+
+		TravelerSegment seg = {pos.row, pos.col, dir};
+		travelers.capacity[k] = SEGMENT_CHUNK;
+		travelers.bodyOffset[k] = allocateSegments(SEGMENT_CHUNK);
+		travelers.bodyHead[k] = 0;
+		bodySegment(k, 0) = seg;
+		travelers.length[k] = 1;
+		travelers.headRow[k] = pos.row;
+		travelers.headCol[k] = pos.col;
+		travelers.headDir[k] = dir;
+		setSquare(pos.row, pos.col, TRAVELER);
+
+		//	I add 0-n segments to my travelers
+		unsigned int numAddSegments = randomBelow(mazeRandom, MAX_NUM_INITIAL_SEGMENTS + 1);
+		TravelerSegment currSeg = seg;
+		bool canAddSegment = true;
+		//	The headless benchmark keeps stdout for its report
+		if (!headlessMode)
+		{
+			cout << "Traveler " << k << " at (row=" << pos.row << ", col=" <<
+			pos.col << "), direction: " << dirStr(dir) << ", with up to " << numAddSegments << " additional segments" << endl;
+			cout << "\t";
+		}
+
+		for (unsigned int s=0; s<numAddSegments && canAddSegment; s++)
+		{
+			TravelerSegment newSeg = newTravelerSegment(currSeg, canAddSegment);
+			if (canAddSegment)
+			{
+				bodySegment(k, travelers.length[k]++) = newSeg;
+				currSeg = newSeg;
+				if (!headlessMode)
+					cout << dirStr(newSeg.dir) << "  ";
+			}
+		}
+		if (!headlessMode)
+			cout << endl;
+
+		for (unsigned int c=0; c<4; c++)
+			travelers.rgba[4*k + c] = travelerColor[k][c];
+		
+		// Initialize traveler's information
+		travelers.pid[k] = 0;
+		travelers.moves[k] = 0;
+		travelers.totalMoves[k] = 0;
+		travelers.exitTime[k] = -1.0;
+	}
+	
+	//	free array of colors
+	for (unsigned int k=0; k<numTravelers; k++)
+		delete []travelerColor[k];
+	delete []travelerColor;
+	vector<unsigned int>().swap(freeSquares);
+	vector<unsigned int>().swap(freeSlot);
+}
+
+//	Sets up the maze of a maze file: its grid section becomes the grid.
+//	With --restore, the travelers also get back their state.
+void loadMaze(const MazeFile& maze)
+{
+	if (restoreState && maze.states == NULL)
+	{
+		cerr << mazePath << " is a maze file, not a checkpoint: use --maze" << endl;
+		exit(1);
+	}
+	gridStride = maze.header->gridStride;
+	grid = reinterpret_cast<atomic<unsigned char>*>(maze.grid);
+	exitPos.row = maze.header->exitRow;
+	exitPos.col = maze.header->exitCol;
+	for (unsigned int k = 0; k < maze.header->numPartitions; k++)
+	{
+		SlidingPartition part;
+		part.isVertical = maze.partitions[k].isVertical != 0;
+		part.start.row = maze.partitions[k].startRow;
+		part.start.col = maze.partitions[k].startCol;
+		part.length = maze.partitions[k].length;
+		partitionList.push_back(part);
+	}
+
+	float** travelerColor = createTravelerColors(numTravelers);
+	const MazeSegment* segment = maze.segments;
+	const MazeSegment* lastSegment = maze.segments + maze.header->numSegments;
+	for (unsigned int k=0; k<numTravelers; k++)
+	{
+		//	Only a checkpoint has travelers that already exited
+		unsigned int length = maze.lengths[k];
+		if ((length == 0 && maze.states == NULL) || length > (unsigned int) (lastSegment - segment))
+		{
+			cerr << "Traveler " << k << " of the maze file has no segments" << endl;
+			exit(1);
+		}
+		for (unsigned int c=0; c<4; c++)
+			travelers.rgba[4*k + c] = travelerColor[k][c];
+		travelers.pid[k] = 0;
+		travelers.moves[k] = 0;
+		travelers.totalMoves[k] = 0;
+		travelers.exitTime[k] = -1.0;
+		if (restoreState)
+		{
+			memcpy(travelers.random[k].s, maze.states[k].random, sizeof(travelers.random[k].s));
+			travelers.moves[k] = maze.states[k].moves;
+			travelers.totalMoves[k] = maze.states[k].totalMoves;
+			travelers.exitTime[k] = maze.states[k].exitTime;
+			restoredMoves += travelers.totalMoves[k];
+			if (length == 0)
+				restoredExited++;
+		}
+		travelers.length[k] = length;
+		if (length == 0)
+		{
+			travelers.capacity[k] = 0;
+			travelers.bodyOffset[k] = 0;
+			travelers.bodyHead[k] = 0;
+			travelers.headRow[k] = exitPos.row;
+			travelers.headCol[k] = exitPos.col;
+			travelers.headDir[k] = NORTH;
+			continue;
+		}
+		unsigned int capacity = SEGMENT_CHUNK;
+		while (capacity < length)
+			capacity *= 2;
+		travelers.capacity[k] = capacity;
+		travelers.bodyOffset[k] = allocateSegments(capacity);
+		travelers.bodyHead[k] = 0;
+		for (unsigned int i = 0; i < length; i++, segment++)
+			bodySegment(k, i) = {segment->row, segment->col, static_cast<Direction>(segment->dir % NUM_DIRECTIONS)};
+		travelers.headRow[k] = bodySegment(k, 0).row;
+		travelers.headCol[k] = bodySegment(k, 0).col;
+		travelers.headDir[k] = bodySegment(k, 0).dir;
+	}
+	if (restoreState)
+	{
+		randomSeed = maze.header->seed;
+		numMovesForGrowth = maze.header->numMovesForGrowth;
+		numTravelersDone = maze.header->numTravelersDone;
+		restoredRunTime = maze.header->runTime;
+	}
+	for (unsigned int k=0; k<numTravelers; k++)
+		delete []travelerColor[k];
+	delete []travelerColor;
+}
+
+//	Free allocated resources.  The travelers must all have terminated.
+void freeApplication(void)
+{
+	joinWorkerPool();
+	joinTileWorkers();
+	stopCheckpointThread();
+	freeParking();
+	dumpLockStats();
+	closeJournal();
+	//	An exported grid is in the export segment
+	if (exportEnabled)
+		closeExport();
+	else if (mazePath.empty())
+		free(grid);
+	if (mazePath.empty())
+		munmap(partitionIndex, numRows * (size_t) numCols * sizeof(atomic<unsigned short>));
+	else
+		unmapMazeFile();
+	grid = NULL;
+	partitionIndex = NULL;
+	delete []travelerSeq;
+	if (occupancyEngine == MUTEX_ENGINE)
+		delete []gridLocks;
+	delete []partitionFlags;
+	delete []partitionSeq;
+	partitionSeq = NULL;
+	partitionList.clear();
+	freeExitDistances();
+	freeTravelerStore();
+	munmap(segmentArena, arenaSize * sizeof(TravelerSegment));
+	segmentArena = NULL;
+	arenaUsed = 0;
+	for (unsigned int i = 0; i < MAX_CAPACITY_LOG; i++)
+		freeSegments[i].clear();
+}
+
+void allocateTravelerStore(void)
+{
+	travelers.count = numTravelers;
+	travelers.headRow = new unsigned int[numTravelers];
+	travelers.headCol = new unsigned int[numTravelers];
+	travelers.headDir = new Direction[numTravelers];
+	travelers.bodyOffset = new unsigned int[numTravelers];
+	travelers.capacity = new unsigned int[numTravelers];
+	travelers.bodyHead = new unsigned int[numTravelers];
+	travelers.length = new unsigned int[numTravelers];
+	travelers.moves = new unsigned int[numTravelers];
+	travelers.totalMoves = new unsigned long[numTravelers];
+	travelers.random = new RandomState[numTravelers];
+	travelers.exitTime = new double[numTravelers];
+	travelers.rgba = new float[4 * numTravelers];
+	travelers.pid = new pthread_t[numTravelers];
+}
+
+void freeTravelerStore(void)
+{
+	delete []travelers.headRow;
+	delete []travelers.headCol;
+	delete []travelers.headDir;
+	delete []travelers.bodyOffset;
+	delete []travelers.capacity;
+	delete []travelers.bodyHead;
+	delete []travelers.length;
+	delete []travelers.moves;
+	delete []travelers.totalMoves;
+	delete []travelers.random;
+	delete []travelers.exitTime;
+	delete []travelers.rgba;
+	delete []travelers.pid;
+	travelers.count = 0;
+}
+
+//	Reserves the address space of the segment arena.  A body buffer holds at
+//	most twice its traveler's length, and the travelers cannot hold more
+//	segments than there are squares, so with the freed buffers being reused,
+//	this leaves ample room.
+void reserveSegmentArena(void)
+{
+	arenaSize = 2UL * SEGMENT_CHUNK * numTravelers + 8UL * numRows * numCols;
+	if (arenaSize > UINT_MAX)
+		arenaSize = UINT_MAX;
+	void* arena = mmap(NULL, arenaSize * sizeof(TravelerSegment), PROT_READ | PROT_WRITE,
+					   MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (arena == MAP_FAILED)
+	{
+		perror("Could not reserve the segment arena");
+		exit(1);
+	}
+	segmentArena = static_cast<TravelerSegment*>(arena);
+	arenaUsed = 0;
+}
+
+//	Returns the log base 2 of a power of 2
+inline unsigned int capacityLog(unsigned int capacity)
+{
+	return __builtin_ctz(capacity);
+}
+
+//	Carves a buffer of count segments (a power of 2) out of the segment arena,
+//	reusing a freed one if possible.  Returns its offset in the arena.
+unsigned int allocateSegments(unsigned int count)
+{
+	unsigned int offset;
+	lockMutex(&arenaLock, ARENA_LOCK);
+		vector<unsigned int>& freeList = freeSegments[capacityLog(count)];
+		if (!freeList.empty())
+		{
+			offset = freeList.back();
+			freeList.pop_back();
+		}
+		else
+		{
+			if (arenaUsed + (size_t) count > arenaSize)
+			{
+				cerr << "The segment arena is full" << endl;
+				exit(1);
+			}
+			offset = arenaUsed;
+			arenaUsed += count;
+		}
+	unlockMutex(&arenaLock, ARENA_LOCK);
+	return offset;
+}
+
+//	Gives back a buffer obtained from allocateSegments.  Its memory stays
+//	mapped, so the renderer may still be reading it: snapshotTraveler then
+//	notices that the traveler changed and starts over.
+void releaseSegments(unsigned int offset, unsigned int count)
+{
+	lockMutex(&arenaLock, ARENA_LOCK);
+		freeSegments[capacityLog(count)].push_back(offset);
+	unlockMutex(&arenaLock, ARENA_LOCK);
+}
+
+//	Moves a full traveler body to a buffer twice as large, with the head first.
+//	Doubling keeps the cost of growth constant per move on average.
+void growTravelerBody(unsigned int index)
+{
+	unsigned int oldOffset = travelers.bodyOffset[index];
+	unsigned int oldCapacity = travelers.capacity[index];
+	unsigned int newOffset = allocateSegments(2 * oldCapacity);
+	for (unsigned int i = 0; i < travelers.length[index]; i++)
+		segmentArena[newOffset + i] = bodySegment(index, i);
+	travelers.bodyOffset[index] = newOffset;
+	travelers.capacity[index] = 2 * oldCapacity;
+	travelers.bodyHead[index] = 0;
+	releaseSegments(oldOffset, oldCapacity);
+}
+
+
+//------------------------------------------------------
+#if 0
+#pragma mark -
+#pragma mark Generation Helper Functions
+#endif
+//------------------------------------------------------
+
+//	Returns a free square, drawn with equal odds from the free squares.  Exits
+//	if the grid is full.
+GridPosition getNewFreePosition(void)
+{
+	if (freeSlot.empty())
+	{
+		for (unsigned int k = 0; k < MAX_FREE_SQUARE_DRAWS; k++)
+		{
+			GridPosition pos = {static_cast<unsigned int>(uniformBelow(mazeRandom, numRows)),
+								static_cast<unsigned int>(uniformBelow(mazeRandom, numCols))};
+			if (squareAt(pos.row, pos.col) == FREE_SQUARE)
+				return pos;
+		}
+		// The grid is getting full
+		freeSlot.assign(numRows * numCols, NO_SLOT);
+		for (unsigned int i = 0; i < numRows; i++)
+			for (unsigned int j = 0; j < numCols; j++)
+				if (squareAt(i, j) == FREE_SQUARE)
+					addFreeSquare(i * numCols + j);
+	}
+	if (freeSquares.empty())
+	{
+		cerr << "The grid has no free square left for " << numTravelers << " travelers" << endl;
+		exit(1);
+	}
+	unsigned int square = freeSquares[uniformBelow(mazeRandom, freeSquares.size())];
+	GridPosition pos = {square / numCols, square % numCols};
+	return pos;
+}
+
+void addFreeSquare(unsigned int square)
+{
+	freeSlot[square] = freeSquares.size();
+	freeSquares.push_back(square);
+}
+
+void removeFreeSquare(unsigned int square)
+{
+	unsigned int slot = freeSlot[square];
+	unsigned int last = freeSquares.back();
+	freeSquares[slot] = last;
+	freeSlot[last] = slot;
+	freeSquares.pop_back();
+	freeSlot[square] = NO_SLOT;
+}
+
+Direction newDirection(RandomState& random, Direction forbiddenDir)
+{
+	bool noDir = true;
+
+	Direction dir = NUM_DIRECTIONS;
+	while (noDir)
+	{
+		dir = static_cast<Direction>(randomBelow(random, NUM_DIRECTIONS));
+		noDir = (dir==forbiddenDir);
+	}
+	return dir;
+}
+
+
+TravelerSegment newTravelerSegment(const TravelerSegment& currentSeg, bool& canAdd)
+{
+	TravelerSegment newSeg;
+	switch (currentSeg.dir)
+	{
+		case NORTH:
+			if (	currentSeg.row < numRows-1 &&
+					squareAt(currentSeg.row+1, currentSeg.col) == FREE_SQUARE)
+			{
+				newSeg.row = currentSeg.row+1;
+				newSeg.col = currentSeg.col;
+				newSeg.dir = newDirection(mazeRandom, SOUTH);
+				setSquare(newSeg.row, newSeg.col, TRAVELER);
+				canAdd = true;
+			}
+			//	no more segment
+			else
+				canAdd = false;
+			break;
+
+		case SOUTH:
+			if (	currentSeg.row > 0 &&
+					squareAt(currentSeg.row-1, currentSeg.col) == FREE_SQUARE)
+			{
+				newSeg.row = currentSeg.row-1;
+				newSeg.col = currentSeg.col;
+				newSeg.dir = newDirection(mazeRandom, NORTH);
+				setSquare(newSeg.row, newSeg.col, TRAVELER);
+				canAdd = true;
+			}
+			//	no more segment
+			else
+				canAdd = false;
+			break;
+
+		case WEST:
+			if (	currentSeg.col < numCols-1 &&
+					squareAt(currentSeg.row, currentSeg.col+1) == FREE_SQUARE)
+			{
+				newSeg.row = currentSeg.row;
+				newSeg.col = currentSeg.col+1;
+				newSeg.dir = newDirection(mazeRandom, EAST);
+				setSquare(newSeg.row, newSeg.col, TRAVELER);
+				canAdd = true;
+			}
+			//	no more segment
+			else
+				canAdd = false;
+			break;
+
+		case EAST:
+			if (	currentSeg.col > 0 &&
+					squareAt(currentSeg.row, currentSeg.col-1) == FREE_SQUARE)
+			{
+				newSeg.row = currentSeg.row;
+				newSeg.col = currentSeg.col-1;
+				newSeg.dir = newDirection(mazeRandom, WEST);
+				setSquare(newSeg.row, newSeg.col, TRAVELER);
+				canAdd = true;
+			}
+			//	no more segment
+			else
+				canAdd = false;
+			break;
+		
+		default:
+			canAdd = false;
+	}
+	
+	return newSeg;
+}
+
+void generateWalls(void)
+{
+	const unsigned int NUM_WALLS = (numCols+numRows)/4;
+
+	//	I decide that a wall length  cannot be less than 3  and not more than
+	//	1/4 the grid dimension in its Direction
+	const unsigned int MIN_WALL_LENGTH = 3;
+	const unsigned int MAX_HORIZ_WALL_LENGTH = numCols / 3;
+	const unsigned int MAX_VERT_WALL_LENGTH = numRows / 3;
+	const unsigned int MAX_NUM_TRIES = 20;
+	//	Walls are placed on NUM_WALLS/2-1 evenly spaced rows and columns: a
+	//	small grid has none, and a thin one can't hold a wall across
+	if (NUM_WALLS/2 <= 1)
+		return;
+	const bool vertOK = MAX_VERT_WALL_LENGTH >= MIN_WALL_LENGTH;
+	const bool horizOK = MAX_HORIZ_WALL_LENGTH >= MIN_WALL_LENGTH;
+
+	bool goodWall = true;
+	
+	//	Generate the vertical walls
+	for (unsigned int w=0; w< NUM_WALLS; w++)
+	{
+		goodWall = false;
+		
+		//	Case of a vertical wall
+		if (randomBelow(mazeRandom, 2))
+		{
+			//	I try a few times before giving up
+			for (unsigned int k=0; k<MAX_NUM_TRIES && !goodWall && vertOK; k++)
+			{
+				//	let's be hopeful
+				goodWall = true;
+				
+				//	select a column index
+				unsigned int HSP = numCols/(NUM_WALLS/2+1);
+				unsigned int col = (1+ static_cast<unsigned int>(nextRandom(mazeRandom))%(NUM_WALLS/2-1))*HSP;
+				unsigned int length = MIN_WALL_LENGTH + static_cast<unsigned int>(nextRandom(mazeRandom))%(MAX_VERT_WALL_LENGTH-MIN_WALL_LENGTH+1);
+				
+				//	now a random start row
+				unsigned int startRow = static_cast<unsigned int>(nextRandom(mazeRandom))%(numRows-length);
+				for (unsigned int row=startRow, i=0; i<length && goodWall; i++, row++)
+				{
+					if (squareAt(row, col) != FREE_SQUARE)
+						goodWall = false;
+				}
+				
+				//	if the wall first, add it to the grid
+				if (goodWall)
+				{
+					for (unsigned int row=startRow, i=0; i<length && goodWall; i++, row++)
+					{
+						setSquare(row, col, WALL);
+					}
+				}
+			}
+		}
+		// case of a horizontal wall
+		else
+		{
+			goodWall = false;
+			
+			//	I try a few times before giving up
+			for (unsigned int k=0; k<MAX_NUM_TRIES && !goodWall && horizOK; k++)
+			{
+				//	let's be hopeful
+				goodWall = true;
+				
+				//	select a column index
+				unsigned int VSP = numRows/(NUM_WALLS/2+1);
+				unsigned int row = (1+ static_cast<unsigned int>(nextRandom(mazeRandom))%(NUM_WALLS/2-1))*VSP;
+				unsigned int length = MIN_WALL_LENGTH + static_cast<unsigned int>(nextRandom(mazeRandom))%(MAX_HORIZ_WALL_LENGTH-MIN_WALL_LENGTH+1);
+				
+				//	now a random start row
+				unsigned int startCol = static_cast<unsigned int>(nextRandom(mazeRandom))%(numCols-length);
+				for (unsigned int col=startCol, i=0; i<length && goodWall; i++, col++)
+				{
+					if (squareAt(row, col) != FREE_SQUARE)
+						goodWall = false;
+				}
+				
+				//	if the wall first, add it to the grid
+				if (goodWall)
+				{
+					for (unsigned int col=startCol, i=0; i<length && goodWall; i++, col++)
+					{
+						setSquare(row, col, WALL);
+					}
+				}
+			}
+		}
+	}
+}
+
+
+void generatePartitions(void)
+{
+	//	Partitions are identified by an unsigned short in partitionIndex
+	const unsigned int NUM_PARTS = min((numCols+numRows)/4, MAX_NUM_PARTITIONS);
+
+	//	I decide that a partition length  cannot be less than 3  and not more than
+	//	1/4 the grid dimension in its Direction
+	const unsigned int MIN_PARTITION_LENGTH = 3;
+	const unsigned int MAX_HORIZ_PART_LENGTH = numCols / 3;
+	const unsigned int MAX_VERT_PART_LENGTH = numRows / 3;
+	const unsigned int MAX_NUM_TRIES = 20;
+	//	Partitions are placed on NUM_PARTS/2-2 evenly spaced rows and columns:
+	//	a small grid has none, and a thin one can't hold a partition across
+	if (NUM_PARTS/2 <= 2)
+		return;
+	const bool vertOK = MAX_VERT_PART_LENGTH >= MIN_PARTITION_LENGTH;
+	const bool horizOK = MAX_HORIZ_PART_LENGTH >= MIN_PARTITION_LENGTH;
+
+	bool goodPart = true;
+
+	for (unsigned int w=0; w< NUM_PARTS; w++)
+	{
+		goodPart = false;
+		
+		//	Case of a vertical partition
+		if (randomBelow(mazeRandom, 2))
+		{
+			//	I try a few times before giving up
+			for (unsigned int k=0; k<MAX_NUM_TRIES && !goodPart && vertOK; k++)
+			{
+				//	let's be hopeful
+				goodPart = true;
+				
+				//	select a column index
+				unsigned int HSP = numCols/(NUM_PARTS/2+1);
+				unsigned int col = (1+ static_cast<unsigned int>(nextRandom(mazeRandom))%(NUM_PARTS/2-2))*HSP + HSP/2;
+				unsigned int length = MIN_PARTITION_LENGTH + static_cast<unsigned int>(nextRandom(mazeRandom))%(MAX_VERT_PART_LENGTH-MIN_PARTITION_LENGTH+1);
+				
+				//	now a random start row
+				unsigned int startRow = static_cast<unsigned int>(nextRandom(mazeRandom))%(numRows-length);
+				for (unsigned int row=startRow, i=0; i<length && goodPart; i++, row++)
+				{
+					if (squareAt(row, col) != FREE_SQUARE)
+						goodPart = false;
+				}
+				
+				//	if the partition is possible,
+				if (goodPart)
+				{
+					//	add it to the grid and to the partition list
+					SlidingPartition part;
+					part.isVertical = true;
+					part.start = {startRow, col};
+					part.length = length;
+					for (unsigned int row=startRow, i=0; i<length && goodPart; i++, row++)
+					{
+						setSquare(row, col, VERTICAL_PARTITION);
+					}
+					partitionList.push_back(part);
+				}
+			}
+		}
+		// case of a horizontal partition
+		else
+		{
+			goodPart = false;
+			
+			//	I try a few times before giving up
+			for (unsigned int k=0; k<MAX_NUM_TRIES && !goodPart && horizOK; k++)
+			{
+				//	let's be hopeful
+				goodPart = true;
+				
+				//	select a column index
+				unsigned int VSP = numRows/(NUM_PARTS/2+1);
+				unsigned int row = (1+ static_cast<unsigned int>(nextRandom(mazeRandom))%(NUM_PARTS/2-2))*VSP + VSP/2;
+				unsigned int length = MIN_PARTITION_LENGTH + static_cast<unsigned int>(nextRandom(mazeRandom))%(MAX_HORIZ_PART_LENGTH-MIN_PARTITION_LENGTH+1);
+				
+				//	now a random start row
+				unsigned int startCol = static_cast<unsigned int>(nextRandom(mazeRandom))%(numCols-length);
+				for (unsigned int col=startCol, i=0; i<length && goodPart; i++, col++)
+				{
+					if (squareAt(row, col) != FREE_SQUARE)
+						goodPart = false;
+				}
+				
+				//	if the wall first, add it to the grid and build SlidingPartition object
+				if (goodPart)
+				{
+					SlidingPartition part;
+					part.isVertical = false;
+					part.start = {row, startCol};
+					part.length = length;
+					for (unsigned int col=startCol, i=0; i<length && goodPart; i++, col++)
+					{
+						setSquare(row, col, HORIZONTAL_PARTITION);
+					}
+					partitionList.push_back(part);
+				}
+			}
+		}
+	}
+}
+
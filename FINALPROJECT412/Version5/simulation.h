@@ -0,0 +1,234 @@
+//
+//  simulation.h
+//  Final Project CSC412
+//
+//  Created by Jean-Yves Hervé on 2020-12-01
+//
+//	Globals and functions of the simulation side of the program, shared by
+//	the GUI build and the headless build.
+
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include <vector>
+#include <string>
+#include <atomic>
+#include <climits>
+#include <pthread.h>
+#include <unistd.h>
+//
+#include "dataTypes.h"
+
+//-----------------------------------------------------------------------------
+//	Global variables (defined in simulation.cpp)
+//-----------------------------------------------------------------------------
+
+//	The grid holds one SquareType byte per square, row after row, surrounded by
+//	a border of WALL squares so that a move never has to check the grid's
+//	bounds.  Each row starts on a cache line: use squareIndex to find a square.
+extern std::atomic<unsigned char> * grid;
+extern unsigned int gridStride;			//	distance between two rows
+extern unsigned int numRows;			//	height of the grid
+extern unsigned int numCols;			//	width
+extern unsigned int numTravelers;		//	initial number
+extern unsigned int numTravelersDone;
+extern unsigned int numLiveThreads;		//	the number of live traveler threads
+extern unsigned int numMovesForGrowth;	//	the number of moves before tail growth
+extern TravelerStore travelers;
+extern std::vector<SlidingPartition> partitionList;
+extern GridPosition exitPos;			//	location of the exit
+extern int travelerSleepTime;			//	in microseconds
+
+extern pthread_mutex_t globalLock;
+extern pthread_mutex_t * gridLocks;		//	row-major, no border
+
+extern OccupancyEngine occupancyEngine;
+extern SchedulerMode schedulerMode;
+extern unsigned int numWorkers;			//	pool workers or tiles, 0 means one per core
+extern NavigationMode navigationMode;
+extern unsigned long long randomSeed;
+extern bool seedGiven;					//	false: randomSeed is drawn at startup
+
+extern bool headlessMode;
+extern double headlessBudget;			//	in seconds
+extern std::atomic<bool> stopRequested;
+extern std::atomic<unsigned long long> totalLockWaitNs;
+extern std::atomic<unsigned long long> totalFailedMoves;
+
+//-----------------------------------------------------------------------------
+//	Grid addressing
+//-----------------------------------------------------------------------------
+
+//	Row and column steps of the four directions
+const int ROW_STEP[NUM_DIRECTIONS] = {-1, 0, 1, 0};
+const int COL_STEP[NUM_DIRECTIONS] = {0, -1, 0, 1};
+
+//	Index in the grid of square (row, col).  Row and column -1 (that is,
+//	UINT_MAX), numRows and numCols land on the border.
+inline unsigned int squareIndex(unsigned int row, unsigned int col)
+{
+	return (row + 1) * gridStride + (col + 1);
+}
+
+//	Index in the grid of the square next to the given one in direction dir
+inline unsigned int neighborIndex(unsigned int square, Direction dir)
+{
+	return square + ROW_STEP[dir] * (int) gridStride + COL_STEP[dir];
+}
+
+//	Gets the square next to (row, col) in direction dir.  Off the grid by one,
+//	it is a square of the border.
+inline void neighborSquare(unsigned int row, unsigned int col, Direction dir,
+						   unsigned int& newRow, unsigned int& newCol)
+{
+	newRow = row + ROW_STEP[dir];
+	newCol = col + COL_STEP[dir];
+}
+
+//-----------------------------------------------------------------------------
+//	Function prototypes
+//-----------------------------------------------------------------------------
+
+//	Defined in simulation.cpp
+bool parseArguments(int argc, char** argv);
+bool parseOption(const char* arg);
+void initializeApplication(void);
+void initializeSimulation(void);
+void freeApplication(void);
+void *travelerFunc(void *arg);
+bool travelerStep(unsigned int index, bool& moved);
+void sleepBetweenTicks(bool moved, unsigned int& waitTime);
+SquareType getSquare(unsigned int row, unsigned int col);
+unsigned int getNumPartitions(void);
+SlidingPartition getPartition(unsigned int index);
+unsigned int snapshotTraveler(unsigned int index, Traveler& copy, std::vector<TravelerSegment>& segments);
+unsigned int snapshotTravelerHead(unsigned int index, TravelerSegment& head);
+void lockMutex(pthread_mutex_t* mutex, LockClass lockClass, unsigned int square = UINT_MAX);
+double elapsedSeconds(void);
+bool applyJournalRecord(const JournalRecord& record);
+
+//	Defined in navigation.cpp
+void computeExitDistances(void);
+void freeExitDistances(void);
+void repairExitDistances(unsigned int blockedRow, unsigned int blockedCol,
+						 unsigned int freedRow, unsigned int freedCol);
+unsigned int flowDirections(unsigned int row, unsigned int col, Direction forbiddenDir,
+							Direction* choices, RandomState& random);
+
+//	Defined in scheduler.cpp
+void startWorkerPool(void);
+void joinWorkerPool(void);
+
+//	Defined in tiles.cpp
+void startTileWorkers(void);
+void joinTileWorkers(void);
+
+//	Defined in journal.cpp
+extern std::string journalPath;			//	--journal=file, empty if none
+extern bool journalEnabled;				//	true while the journal is open
+void openJournal(const char* path);
+void journalEvent(JournalEventType type, unsigned int id, unsigned long tick,
+				  unsigned int fromRow, unsigned int fromCol,
+				  unsigned int toRow, unsigned int toCol, Direction dir);
+void flushJournal(void);
+void closeJournal(void);
+bool readJournal(const char* path, JournalHeader& header, std::vector<JournalRecord>& records);
+unsigned long long gridChecksum(void);
+
+//	Defined in maze.cpp
+extern std::string mazePath;			//	--maze=file, empty if none
+extern std::string saveMazePath;		//	--save-maze=file, empty if none
+extern bool verifyMaze;					//	--verify-maze: check the whole maze file
+bool saveMazeFile(const char* path, bool withState);
+void mapMazeFile(const char* path, MazeFile& maze);
+void unmapMazeFile(void);
+
+//	Rounds an offset in a file or a shared-memory segment up to a page boundary
+inline uint64_t pageAligned(uint64_t offset)
+{
+	uint64_t pageSize = sysconf(_SC_PAGESIZE);
+	return (offset + pageSize - 1) / pageSize * pageSize;
+}
+
+//	Defined in export.cpp
+extern std::string exportName;			//	--export=name, empty if none
+extern bool exportEnabled;				//	true while the grid is in the export segment
+void openExport(void);
+void closeExport(void);
+
+//	Defined in parking.cpp
+extern bool parkingEnabled;				//	with --scheduler=threads
+extern std::atomic<unsigned int> numParked;
+void initializeParking(void);
+void freeParking(void);
+void parkTraveler(unsigned int index, const unsigned int* squares, unsigned int numSquares);
+void unparkSquare(unsigned int square);
+void unparkAllTravelers(void);
+
+//	To be called once a square (a grid index) is released: wakes the
+//	travelers parked on it.  The fence pairs with the one in parkTraveler.
+inline void notifySquareFreed(unsigned int square)
+{
+	if (!parkingEnabled)
+		return;
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (numParked.load(std::memory_order_acquire) > 0)
+		unparkSquare(square);
+}
+
+//	Defined in checkpoint.cpp
+extern std::string checkpointPath;		//	--checkpoint=file
+extern bool restoreState;				//	--restore=file: mazePath is a checkpoint
+extern double restoredRunTime;			//	run time at the checkpoint, in seconds
+extern unsigned long long restoredMoves;	//	moves made before the checkpoint
+extern unsigned int restoredExited;		//	travelers that exited before it
+extern std::atomic<bool> pauseRequested;
+void addRunners(unsigned int count);
+void removeRunner(void);
+void pausePoint(void);
+double runTimeSeconds(void);
+bool writeCheckpoint(void);
+void requestCheckpoint(void);
+void startCheckpointThread(void);
+void stopCheckpointThread(void);
+
+//	To be called by a runner between moves: waits while a checkpoint is
+//	being written
+inline void checkPause(void)
+{
+	if (pauseRequested.load(std::memory_order_relaxed))
+		pausePoint();
+}
+
+//	Defined in lockstats.cpp.  Without LOCK_STATS, the recording functions do
+//	nothing and cost nothing.  Squares are numbered row * numCols + col, and
+//	UINT_MAX stands for a lock that is not a square's.
+#ifdef LOCK_STATS
+extern std::string lockStatsPath;		//	--lock-stats=prefix
+void initializeLockStats(void);
+void recordLockAcquired(LockClass lockClass, unsigned int square, bool contended, unsigned long long waitNs);
+void recordLockReleased(LockClass lockClass, unsigned int square);
+void recordLockFailed(LockClass lockClass, unsigned int square);
+void flushLockStats(void);
+void dumpLockStats(void);
+#else
+inline void initializeLockStats(void) {}
+inline void recordLockAcquired(LockClass, unsigned int, bool, unsigned long long) {}
+inline void recordLockReleased(LockClass, unsigned int) {}
+inline void recordLockFailed(LockClass, unsigned int) {}
+inline void flushLockStats(void) {}
+inline void dumpLockStats(void) {}
+#endif
+
+//	Unlocks a mutex locked with lockMutex
+inline void unlockMutex(pthread_mutex_t* mutex, LockClass lockClass, unsigned int square = UINT_MAX)
+{
+	recordLockReleased(lockClass, square);
+	pthread_mutex_unlock(mutex);
+}
+
+//	Defined in benchmark.cpp
+void runHeadless(RunStats& stats);
+int runHeadlessBenchmark(void);
+
+#endif // SIMULATION_H
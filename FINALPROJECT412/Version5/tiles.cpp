@@ -0,0 +1,236 @@
+//
+//  tiles.cpp
+//  Final Project CSC412
+//
+//	Domain decomposition of the grid (--scheduler=tiles).  The grid is split
+//	into rectangular tiles, one per worker thread (one per core by default).
+//	A worker advances the travelers whose head is in its tile, one move attempt
+//	each per tick, so that it mostly touches its own part of the grid and of
+//	the traveler lists.  Workers are pinned to a core each, which keeps a tile
+//	on the same socket for the whole run.
+//
+//	A traveler whose head crosses into another tile is handed to that tile's
+//	worker through the tile's inbox, which the worker empties between ticks.
+//	Squares are still claimed with claimSquare: the squares near the edge of a
+//	tile are contended by the workers on both sides, and partitions and
+//	traveler bodies can span tiles.  Inside a tile, only its worker claims
+//	squares for a traveler's head, so those claims are uncontended.
+//	Ticks are separated by travelerSleepTime (or more while no traveler
+//	moves), and checkpoints are written between ticks, as with the worker pool.
+
+#include <vector>
+#include <atomic>
+//
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+#include <sched.h>
+//
+#include "simulation.h"
+
+using namespace std;
+
+//-----------------------------------------------------------------------------
+//	Custom Data Type
+//-----------------------------------------------------------------------------
+struct Tile
+{
+	/**	Index of the tile, row-major in the grid of tiles
+	 */
+	unsigned int index;
+
+	/**	The thread of the tile's worker
+	 */
+	pthread_t thread;
+
+	/**	This tick's travelers (those whose head is in the tile).  Only
+	 *	touched by the tile's worker.
+	 */
+	vector<unsigned int> travelers;
+
+	/**	The travelers that stay in the tile for the next tick
+	 */
+	vector<unsigned int> next;
+
+	/**	Protects inbox, to which the workers of other tiles add travelers
+	 */
+	pthread_mutex_t inboxLock;
+
+	/**	Travelers handed over by other tiles during this tick
+	 */
+	vector<unsigned int> inbox;
+};
+
+//---------------------------------------------------------------------------
+//  File-level global variables
+//---------------------------------------------------------------------------
+vector<Tile> tileList;
+//	Dimensions of the grid of tiles, and of a tile (the last row and column
+//	of tiles may be smaller)
+unsigned int numTileRows = 0, numTileCols = 0;
+unsigned int tileHeight = 0, tileWidth = 0;
+//	Travelers still live at the end of the current tick, summed over the tiles
+atomic<unsigned int> liveTaskCount(0);
+//	Number of live travelers, set by one worker between ticks
+unsigned int tileTaskCount = 0;
+//	Set when a traveler moves during the current tick
+atomic<bool> tileMoved(false);
+//	Backoff between ticks, only touched by the worker that sleeps
+unsigned int tileWaitTime = 0;
+pthread_barrier_t tileBarrier;
+
+//---------------------------------------------------------------------------
+//  Private functions' prototypes
+//---------------------------------------------------------------------------
+void* tileWorkerFunc(void* arg);
+void chooseTileLayout(unsigned int numTiles);
+unsigned int tileOf(unsigned int row, unsigned int col);
+
+
+void startTileWorkers(void)
+{
+	unsigned int numTiles = numWorkers;
+	if (numTiles == 0)
+		numTiles = sysconf(_SC_NPROCESSORS_ONLN);
+	if (numTiles > numRows * numCols)
+		numTiles = numRows * numCols;
+	if (numTiles == 0 || numLiveThreads == 0)
+		return;
+	chooseTileLayout(numTiles);
+
+	tileList.resize(numTileRows * numTileCols);
+	pthread_barrier_init(&tileBarrier, NULL, tileList.size());
+	for (unsigned int t=0; t<tileList.size(); t++)
+	{
+		tileList[t].index = t;
+		pthread_mutex_init(&tileList[t].inboxLock, NULL);
+	}
+	//	Each live traveler goes to the tile of its head
+	for (unsigned int k=0; k<numTravelers; k++)
+		if (travelers.length[k] > 0)
+			tileList[tileOf(travelers.headRow[k], travelers.headCol[k])].travelers.push_back(k);
+	liveTaskCount = 0;
+	tileTaskCount = numLiveThreads;
+	tileMoved = false;
+	tileWaitTime = 0;
+	//	The tiles are a single runner: the worker that pauses between ticks
+	addRunners(1);
+
+	unsigned int numCores = sysconf(_SC_NPROCESSORS_ONLN);
+	for (unsigned int t=0; t<tileList.size(); t++)
+	{
+		pthread_create(&tileList[t].thread, NULL, tileWorkerFunc, &tileList[t]);
+		cpu_set_t cores;
+		CPU_ZERO(&cores);
+		CPU_SET(t % numCores, &cores);
+		pthread_setaffinity_np(tileList[t].thread, sizeof(cores), &cores);
+	}
+}
+
+//	Waits for the tile workers to terminate, which they do once all travelers
+//	have left the simulation
+void joinTileWorkers(void)
+{
+	for (unsigned int t=0; t<tileList.size(); t++)
+	{
+		pthread_join(tileList[t].thread, NULL);
+		pthread_mutex_destroy(&tileList[t].inboxLock);
+	}
+	if (!tileList.empty())
+		pthread_barrier_destroy(&tileBarrier);
+	tileList.clear();
+}
+
+void* tileWorkerFunc(void* arg)
+{
+	Tile& tile = *(Tile*) arg;
+	while (tileTaskCount > 0)
+	{
+		//	Run this tick's travelers.  Those that moved out of the tile go
+		//	to the inbox of their new tile.
+		bool moved = false;
+		for (unsigned int k=0; k<tile.travelers.size(); k++)
+		{
+			unsigned int task = tile.travelers[k];
+			if (!travelerStep(task, moved))
+				continue;
+			unsigned int owner = tileOf(travelers.headRow[task], travelers.headCol[task]);
+			if (owner == tile.index)
+				tile.next.push_back(task);
+			else
+			{
+				lockMutex(&tileList[owner].inboxLock, INBOX_LOCK);
+					tileList[owner].inbox.push_back(task);
+				unlockMutex(&tileList[owner].inboxLock, INBOX_LOCK);
+			}
+		}
+		if (moved)
+			tileMoved.store(true, memory_order_relaxed);
+		pthread_barrier_wait(&tileBarrier);
+
+		//	All handovers of the tick are in: take them for the next tick
+		tile.travelers.swap(tile.next);
+		tile.next.clear();
+		lockMutex(&tile.inboxLock, INBOX_LOCK);
+			tile.travelers.insert(tile.travelers.end(), tile.inbox.begin(), tile.inbox.end());
+			tile.inbox.clear();
+		unlockMutex(&tile.inboxLock, INBOX_LOCK);
+		liveTaskCount.fetch_add(tile.travelers.size(), memory_order_acq_rel);
+
+		//	One worker sleeps between ticks and takes the task count, which
+		//	no worker reads until all are past the last barrier
+		if (pthread_barrier_wait(&tileBarrier) == PTHREAD_BARRIER_SERIAL_THREAD)
+		{
+			checkPause();
+			sleepBetweenTicks(tileMoved.exchange(false, memory_order_relaxed), tileWaitTime);
+			tileTaskCount = liveTaskCount.exchange(0, memory_order_acq_rel);
+		}
+		pthread_barrier_wait(&tileBarrier);
+	}
+	if (journalEnabled)
+		flushJournal();
+	flushLockStats();
+	if (tile.index == 0)
+		removeRunner();
+	return NULL;
+}
+
+//	Splits the grid into numTiles tiles (or a few less), in the layout whose
+//	tiles are closest to square, since a tile's border is where its travelers
+//	compete with those of other tiles.
+void chooseTileLayout(unsigned int numTiles)
+{
+	double bestRatio = 0.0;
+	for (unsigned int rows=1; rows<=numTiles; rows++)
+	{
+		if (numTiles % rows != 0 || rows > numRows || numTiles / rows > numCols)
+			continue;
+		double ratio = (double(numRows) / rows) / (double(numCols) / (numTiles / rows));
+		if (ratio > 1.0)
+			ratio = 1.0 / ratio;
+		if (ratio > bestRatio)
+		{
+			bestRatio = ratio;
+			numTileRows = rows;
+			numTileCols = numTiles / rows;
+		}
+	}
+	//	No exact layout fits the grid (a prime number of tiles on a thin
+	//	grid): one row or column of tiles
+	if (bestRatio == 0.0)
+	{
+		numTileRows = numRows >= numCols ? numTiles : 1;
+		numTileCols = numRows >= numCols ? 1 : numTiles;
+	}
+	tileHeight = (numRows + numTileRows - 1) / numTileRows;
+	tileWidth = (numCols + numTileCols - 1) / numTileCols;
+	//	Rounding up the tile sizes can leave the last tiles empty
+	numTileRows = (numRows + tileHeight - 1) / tileHeight;
+	numTileCols = (numCols + tileWidth - 1) / tileWidth;
+}
+
+//	Index of the tile containing square (row, col)
+unsigned int tileOf(unsigned int row, unsigned int col)
+{
+	return (row / tileHeight) * numTileCols + col / tileWidth;
+}
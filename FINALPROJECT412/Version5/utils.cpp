@@ -72,3 +72,90 @@ std::string typeStr(const SquareType& type)
 	return outStr;
 }
 
+
+float** createTravelerColors(unsigned int numTravelers)
+{
+	float** travelerColor = new float*[numTravelers];
+
+	float hueStep = 360.f / numTravelers;
+
+	for (unsigned int k=0; k<numTravelers; k++)
+	{
+		travelerColor[k] = new float[4];
+
+		//	compute a hue for the door
+		float hue = k*hueStep;
+		//	convert the hue to an RGB color
+		int hueRegion = (int) (hue / 60);
+		switch (hueRegion)
+		{
+				//  hue in [0, 60] -- red-green, dominant red
+			case 0:
+				travelerColor[k][0] = 1.f;					//  red is max
+				travelerColor[k][1] = hue / 60.f;			//  green calculated
+				travelerColor[k][2] = 0.f;					//  blue is zero
+				break;
+
+				//  hue in [60, 120] -- red-green, dominant green
+			case 1:
+				travelerColor[k][0] = (120.f - hue) / 60.f;	//  red is calculated
+				travelerColor[k][1] = 1.f;					//  green max
+				travelerColor[k][2] = 0.f;					//  blue is zero
+				break;
+
+				//  hue in [120, 180] -- green-blue, dominant green
+			case 2:
+				travelerColor[k][0] = 0.f;					//  red is zero
+				travelerColor[k][1] = 1.f;					//  green max
+				travelerColor[k][2] = (hue - 120.f) / 60.f;	//  blue is calculated
+				break;
+
+				//  hue in [180, 240] -- green-blue, dominant blue
+			case 3:
+				travelerColor[k][0] = 0.f;					//  red is zero
+				travelerColor[k][1] = (240.f - hue) / 60;	//  green calculated
+				travelerColor[k][2] = 1.f;					//  blue is max
+				break;
+
+				//  hue in [240, 300] -- blue-red, dominant blue
+			case 4:
+				travelerColor[k][0] = (hue - 240.f) / 60;	//  red is calculated
+				travelerColor[k][1] = 0;						//  green is zero
+				travelerColor[k][2] = 1.f;					//  blue is max
+				break;
+
+				//  hue in [300, 360] -- blue-red, dominant red
+			case 5:
+				travelerColor[k][0] = 1.f;					//  red is max
+				travelerColor[k][1] = 0;						//  green is zero
+				travelerColor[k][2] = (360.f - hue) / 60;	//  blue is calculated
+				break;
+
+			default:
+				break;
+
+		}
+		travelerColor[k][3] = 1.f;					//  alpha --> full opacity
+	}
+
+	return travelerColor;
+}
+
+
+//	Mixes a 64-bit state (splitmix64), to turn a seed into generator states
+static uint64_t splitMix(uint64_t& state)
+{
+	uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+void seedRandom(RandomState& random, uint64_t seed, uint64_t stream)
+{
+	uint64_t state = seed;
+	//	Each stream starts from a different point of the seed's sequence
+	state ^= splitMix(stream);
+	for (int k = 0; k < 4; k++)
+		random.s[k] = splitMix(state);
+}
@@ -0,0 +1,278 @@
+//
+//  viewer.cpp
+//  Final Project CSC412
+//
+//	Entry point of traveler_viewer, which draws a simulation running in
+//	another process with --export=name, using the same front end as the GUI.
+//	The shared-memory segment is mapped read-only: the grid is read as the
+//	simulation updates it, and the travelers, partitions and counters are
+//	copied from the last frame published once per redraw (see export.cpp).
+//	Any number of viewers can attach to a simulation, and come and go.
+//
+//	Usage: traveler_viewer name
+
+#include <vector>
+#include <atomic>
+//
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <csignal>
+#include <unistd.h>
+#include <sched.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+//
+#include "gl_frontEnd.h"
+
+using namespace std;
+
+//==================================================================================
+//	Global variables, named as the front end expects them
+//==================================================================================
+
+unsigned int numRows = 0;
+unsigned int numCols = 0;
+unsigned int numLiveThreads = 0;
+GridPosition exitPos;
+
+const int MAX_NUM_MESSAGES = 8;
+const int MAX_LENGTH_MESSAGE = 32;
+char** message;
+
+//	The mapped segment
+const char EXPORT_MAGIC[4] = {'T', 'R', 'V', 'X'};
+const uint32_t EXPORT_VERSION = 1;
+const ExportHeader* exportHeader = NULL;
+const atomic<unsigned char>* exportGrid = NULL;
+const char* exportName = NULL;
+
+//	The last frame read (frameCounters.seq is not used)
+ExportFrame frameCounters;
+vector<ExportTraveler> frameTravelers;
+vector<MazePartition> framePartitions;
+vector<MazeSegment> frameSegments;
+//	Tries at reading a frame before the last one read is drawn again
+const unsigned int MAX_FRAME_READ_TRIES = 8;
+
+//==================================================================================
+//	Functions
+//==================================================================================
+
+//	Maps the segment a simulation exports, and sets up the grid's dimensions
+//	from it.  Exits if there is no such segment.
+void attachExport(const char* name)
+{
+	string shmName = (name[0] == '/') ? name : string("/") + name;
+	int fd = shm_open(shmName.c_str(), O_RDONLY, 0);
+	struct stat status;
+	if (fd < 0 || fstat(fd, &status) != 0)
+	{
+		perror(shmName.c_str());
+		exit(1);
+	}
+	void* mapping = status.st_size < (off_t) sizeof(ExportHeader) ? MAP_FAILED :
+					mmap(NULL, status.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	const ExportHeader* header = static_cast<const ExportHeader*>(mapping);
+	if (mapping == MAP_FAILED || memcmp(header->magic, EXPORT_MAGIC, sizeof(header->magic)) != 0 ||
+		header->version != EXPORT_VERSION || header->size != (uint64_t) status.st_size)
+	{
+		fprintf(stderr, "%s is not exported by a simulation\n", shmName.c_str());
+		exit(1);
+	}
+	exportHeader = header;
+	exportGrid = reinterpret_cast<const atomic<unsigned char>*>(
+					 static_cast<const char*>(mapping) + header->gridOffset);
+	numRows = header->numRows;
+	numCols = header->numCols;
+	exitPos.row = header->exitRow;
+	exitPos.col = header->exitCol;
+}
+
+//	true once the simulation has ended, or its process is gone
+bool simulationEnded(void)
+{
+	return exportHeader->finished.load(memory_order_acquire) != 0 ||
+		   (kill(exportHeader->pid, 0) != 0 && errno == ESRCH);
+}
+
+//	Copies the last frame published, if any.  A frame being rewritten while
+//	it is copied is copied again, after yielding the core to the simulation
+//	that writes it.  After MAX_FRAME_READ_TRIES, the last frame read is kept.
+void readFrame(void)
+{
+	static vector<ExportTraveler> travelerCopy;
+	static vector<MazePartition> partitionCopy;
+	static vector<MazeSegment> segmentCopy;
+	ExportFrame counters;
+
+	uint64_t generation = exportHeader->generation.load(memory_order_acquire);
+	if (generation == 0)
+		return;
+	for (unsigned int tries = 0; ; tries++)
+	{
+		if (tries == MAX_FRAME_READ_TRIES)
+			return;
+		if (tries > 0)
+			sched_yield();
+		const ExportFrame* frame = reinterpret_cast<const ExportFrame*>(
+			reinterpret_cast<const char*>(exportHeader) + exportHeader->frameOffset[generation % 2]);
+		uint32_t seq = frame->seq.load(memory_order_acquire);
+		if ((seq & 1) == 0)
+		{
+			const ExportTraveler* travelers = reinterpret_cast<const ExportTraveler*>(frame + 1);
+			const MazePartition* partitions =
+				reinterpret_cast<const MazePartition*>(travelers + exportHeader->numTravelers);
+			const MazeSegment* segments =
+				reinterpret_cast<const MazeSegment*>(partitions + exportHeader->numPartitions);
+			uint32_t numSegments = min(frame->numSegments, exportHeader->maxSegments);
+			travelerCopy.assign(travelers, travelers + exportHeader->numTravelers);
+			partitionCopy.assign(partitions, partitions + exportHeader->numPartitions);
+			segmentCopy.assign(segments, segments + numSegments);
+			counters.numSegments = numSegments;
+			counters.numTravelersDone = frame->numTravelersDone;
+			counters.numLiveThreads = frame->numLiveThreads;
+			counters.travelerSleepTime = frame->travelerSleepTime;
+			counters.runTime = frame->runTime;
+			atomic_thread_fence(memory_order_acquire);
+			if (frame->seq.load(memory_order_relaxed) == seq)
+				break;
+		}
+		//	A simulation killed while writing the frame will never finish it
+		else if (simulationEnded())
+			return;
+		generation = exportHeader->generation.load(memory_order_acquire);
+	}
+	frameTravelers.swap(travelerCopy);
+	framePartitions.swap(partitionCopy);
+	frameSegments.swap(segmentCopy);
+	frameCounters.numSegments = counters.numSegments;
+	frameCounters.numTravelersDone = counters.numTravelersDone;
+	frameCounters.numLiveThreads = counters.numLiveThreads;
+	frameCounters.travelerSleepTime = counters.travelerSleepTime;
+	frameCounters.runTime = counters.runTime;
+	numLiveThreads = frameCounters.numLiveThreads;
+}
+
+//==================================================================================
+//	The functions the front end calls
+//==================================================================================
+
+SquareType getSquare(unsigned int row, unsigned int col)
+{
+	return static_cast<SquareType>(
+		exportGrid[(row + 1) * (size_t) exportHeader->gridStride + col + 1].load(memory_order_relaxed));
+}
+
+unsigned int getNumPartitions(void)
+{
+	return framePartitions.size();
+}
+
+SlidingPartition getPartition(unsigned int index)
+{
+	const MazePartition& exported = framePartitions[index];
+	SlidingPartition partition;
+	partition.isVertical = exported.isVertical;
+	partition.start.row = exported.startRow;
+	partition.start.col = exported.startCol;
+	partition.length = exported.length;
+	return partition;
+}
+
+//	The grid pane is drawn first, so the frame is read there
+void drawTravelers(void)
+{
+	readFrame();
+
+	static vector<TravelerSegment> body;
+	unsigned int firstRow, lastRow, firstCol, lastCol;
+	getVisibleSquares(firstRow, lastRow, firstCol, lastCol);
+	bool densityView = isDensityView();
+	for (unsigned int k=0; k<frameTravelers.size(); k++)
+	{
+		const ExportTraveler& exported = frameTravelers[k];
+		const unsigned int length = exported.length;
+		if (length == 0 || exported.firstSegment + (size_t) length > frameSegments.size())
+			continue;
+		const MazeSegment& head = frameSegments[exported.firstSegment];
+		if (densityView)
+		{
+			drawTravelerHead(head.row, head.col, exported.rgba);
+			continue;
+		}
+		//	The body lies within length squares of the head
+		if (head.row + length < firstRow || head.row > lastRow + length ||
+			head.col + length < firstCol || head.col > lastCol + length)
+			continue;
+
+		//	segmentAt wants a buffer whose size is a power of 2
+		unsigned int capacity = 1;
+		while (capacity < length)
+			capacity *= 2;
+		if (body.size() < capacity)
+			body.resize(capacity);
+		for (unsigned int i=0; i<length; i++)
+		{
+			const MazeSegment& segment = frameSegments[exported.firstSegment + i];
+			body[i].row = segment.row;
+			body[i].col = segment.col;
+			body[i].dir = static_cast<Direction>(segment.dir % NUM_DIRECTIONS);
+		}
+		Traveler traveler;
+		traveler.index = k;
+		memcpy(traveler.rgba, exported.rgba, sizeof(traveler.rgba));
+		traveler.body = body.data();
+		traveler.capacity = capacity;
+		traveler.head = 0;
+		traveler.length = length;
+		drawTraveler(traveler);
+	}
+	drawTravelerBatch();
+}
+
+void updateMessages(void)
+{
+	unsigned int numMessages = 5;
+	snprintf(message[0], MAX_LENGTH_MESSAGE+1, "Viewing %s", exportName);
+	snprintf(message[1], MAX_LENGTH_MESSAGE+1, "We created %u travelers", exportHeader->numTravelers);
+	snprintf(message[2], MAX_LENGTH_MESSAGE+1, "%u travelers solved the maze", frameCounters.numTravelersDone);
+	snprintf(message[3], MAX_LENGTH_MESSAGE+1, "Traveler's sleep time is %d", frameCounters.travelerSleepTime);
+	if (simulationEnded())
+		snprintf(message[4], MAX_LENGTH_MESSAGE+1, "The simulation has ended");
+	else
+		snprintf(message[4], MAX_LENGTH_MESSAGE+1, "Simulation run time is %.0f", frameCounters.runTime);
+	drawMessages(numMessages, message);
+}
+
+//	The viewer can't change the simulation: only 'esc' does something
+void handleKeyboardEvent(unsigned char c, int x, int y)
+{
+	if (c == 27)
+		exit(0);
+}
+
+
+int main(int argc, char** argv)
+{
+	if (argc < 2 || argv[1][0] == '-')
+	{
+		fprintf(stderr, "Usage: %s name\n", argv[0]);
+		fprintf(stderr, "   (name as given to the simulation with --export=name)\n");
+		exit(1);
+	}
+	exportName = argv[1];
+	attachExport(exportName);
+
+	message = new char*[MAX_NUM_MESSAGES];
+	for (unsigned int k=0; k<MAX_NUM_MESSAGES; k++)
+		message[k] = new char[MAX_LENGTH_MESSAGE+1];
+
+	initializeFrontEnd(argc, argv);
+	glutMainLoop();
+
+	return 0;
+}